@@ -0,0 +1,209 @@
+/*******************************************************************************
+ *  @author             Karl Jansen (kmjansen@uw.edu)
+ *  @version            1.2, 03/16/2015
+ *
+ *  Compilation:        N/A
+ *  Execution:          N/A
+ *  Dependencies:       NONE;
+ *
+ *  Purpose:
+ *  This is the implementation of the CompiledAutomaton class.
+ *
+ *  Functionality:
+ *  The NFA-epsilon is converted to a DFA within the budget. A conversion that
+ *  completes is compiled to a CompiledDfa, the fastest to run. Otherwise the
+ *  partial DFA is dropped, and a NFA-epsilon with only byte transitions is
+ *  compiled to a CompiledLazyDfa, which builds the DFA states the inputs reach.
+ *  A CompiledNfaEpsilon is built next to it, and replaces it once its cache
+ *  thrashes, since the inputs then reach more states than it can hold.
+ *  A NFA-epsilon with wider symbols is compiled to a CompiledNfaEpsilon, whose
+ *  size is linear in the NFA-epsilon.
+ *  Every limit of the budget bounds the conversion. The node and memory
+ *  limits also bound the cache of the lazy DFA: it holds at most the node
+ *  limit of states (or its default if there is none), and no more than fit
+ *  in the memory limit once both engines are built, counting every state at
+ *  its largest size. If not even the fewest states fit, only the
+ *  CompiledNfaEpsilon is kept. The time limit does not apply to recognition,
+ *  and the size of a CompiledDfa or CompiledNfaEpsilon is not limited.
+ *
+ *  Assumptions:
+ *  A valid NFA-epsilon FiniteStateMachine is passed into the constructor. A
+ *  CompiledLazyDfa fills in its cache while recognizing, so a
+ *  CompiledAutomaton must not be shared between threads.
+ *
+*******************************************************************************/
+
+#include "CompiledAutomaton.h"
+
+/*******************************************************************************
+ * Overloaded Constructor
+ * This is public, and chooses and builds the compiled automaton for a
+ * NFA-epsilon that can be run fastest given the budget for converting it to a
+ * DFA. The FSM is not kept after construction.
+ * @param finiteStateMachine
+ *                      a valid NFA-epsilon FiniteStateMachine
+ * @param budget        the limits on converting it to a DFA
+ */
+CompiledAutomaton::CompiledAutomaton(const FiniteStateMachine& originalFiniteStateMachine,
+                                     const ConversionBudget& budget) {
+   ConversionResult conversion = convertNfaEpsilonToDfa(originalFiniteStateMachine, budget);
+   conversionStatus = conversion.status;
+   conversionSeconds = conversion.seconds;
+   if (conversionStatus == CONVERSION_COMPLETE) {
+      kind = COMPILED_DFA;
+      dfa.reset(new CompiledDfa(conversion.dfa));
+   } else if (hasOnlyByteTransitions(originalFiniteStateMachine)) {
+      kind = COMPILED_LAZY_DFA;
+      int maxCachedStates = budget.maxStates > 0 ? static_cast<int>(budget.maxStates)
+                                                 : CompiledLazyDfa::DEFAULT_MAX_CACHED_STATES;
+      lazyDfa.reset(new CompiledLazyDfa(originalFiniteStateMachine, maxCachedStates));
+      nfaEpsilon.reset(new CompiledNfaEpsilon(originalFiniteStateMachine));
+      if (budget.maxMemoryBytes > 0) {
+         limitLazyDfaMemory(budget.maxMemoryBytes, maxCachedStates);
+      }
+   } else {
+      kind = COMPILED_NFA_EPSILON;
+      nfaEpsilon.reset(new CompiledNfaEpsilon(originalFiniteStateMachine));
+   }
+}
+
+/*******************************************************************************
+ * Is Recognized
+ * This public method tries to recognize an input string with the chosen
+ * compiled automaton.
+ * @param inputStr      a string to check, one byte per symbol
+ * @return              true if the input string is recognized
+ *                      false if the input string is not recognized
+ */
+bool CompiledAutomaton::isRecognized(const std::string& stringToTest) {
+   switch (kind) {
+      case COMPILED_DFA:
+         return dfa->isRecognized(stringToTest);
+      case COMPILED_LAZY_DFA: {
+         bool isRecognized = lazyDfa->isRecognized(stringToTest);
+         updateLazyDfa();
+         return isRecognized;
+      }
+      default:
+         return nfaEpsilon->isRecognized(stringToTest);
+   }
+}
+
+/*******************************************************************************
+ * Is Recognized
+ * This public method tries to recognize a sequence of wide symbols (Unicode
+ * code points or integer tokens) with the chosen compiled automaton.
+ * @param symbolsToTest a sequence of non-negative symbols to check
+ * @return              true if the input sequence is recognized
+ *                      false if the input sequence is not recognized
+ */
+bool CompiledAutomaton::isRecognized(const std::vector<int>& symbolsToTest) {
+   switch (kind) {
+      case COMPILED_DFA:
+         return dfa->isRecognized(symbolsToTest);
+      case COMPILED_LAZY_DFA: {
+         bool isRecognized = lazyDfa->isRecognized(symbolsToTest);
+         updateLazyDfa();
+         return isRecognized;
+      }
+      default:
+         return nfaEpsilon->isRecognized(symbolsToTest);
+   }
+}
+
+/*******************************************************************************
+ * Getters
+ * These public methods return the kind of compiled automaton in use, how the
+ * conversion to a DFA ended, and how many seconds it took.
+ */
+AutomatonKind CompiledAutomaton::getKind() const {
+   return kind;
+}
+
+ConversionStatus CompiledAutomaton::getConversionStatus() const {
+   return conversionStatus;
+}
+
+double CompiledAutomaton::getConversionSeconds() const {
+   return conversionSeconds;
+}
+
+/*******************************************************************************
+ * Get Memory Usage
+ * This public method returns the number of bytes used by this object and the
+ * compiled automaton it chose.
+ * @return              the number of bytes used
+ */
+size_t CompiledAutomaton::getMemoryUsage() const {
+   switch (kind) {
+      case COMPILED_DFA:
+         return sizeof(CompiledAutomaton) + dfa->getMemoryUsage();
+      case COMPILED_LAZY_DFA:
+         return sizeof(CompiledAutomaton) + lazyDfa->getMemoryUsage() +
+                nfaEpsilon->getMemoryUsage();
+      default:
+         return sizeof(CompiledAutomaton) + nfaEpsilon->getMemoryUsage();
+   }
+}
+
+/*******************************************************************************
+ * Default Constructor
+ * This is private, and cannot be accessed by a client using this class.
+ */
+CompiledAutomaton::CompiledAutomaton() {
+   // Empty
+}
+
+/*******************************************************************************
+ * Has Only Byte Transitions
+ * A private helper method to determine if every transition of a finite state
+ * machine is an epsilon transition or on bytes (0-255).
+ * @param finiteStateMachine
+ *                      a finite state machine
+ * @return              true if a CompiledLazyDfa can be built from it
+ */
+bool CompiledAutomaton::hasOnlyByteTransitions(const FiniteStateMachine& originalFiniteStateMachine) const {
+   for (const auto& transition : originalFiniteStateMachine.transitions) {
+      if (transition.transitionChar != FiniteStateMachine::EPSILON &&
+          (transition.transitionChar < 0 || transition.getLastTransitionChar() > 255)) {
+         return false;
+      }
+   }
+   return true;
+}
+
+/*******************************************************************************
+ * Limit Lazy DFA Memory
+ * A private helper method to limit the cache of the lazy DFA to the states
+ * that fit in a memory budget after this object and both engines, as built
+ * with their first cached states, or to drop the lazy DFA if too few fit.
+ * @param maxMemoryBytes
+ *                      the most bytes this object may hold
+ * @param maxCachedStates
+ *                      the most states the cache may hold otherwise
+ */
+void CompiledAutomaton::limitLazyDfaMemory(size_t maxMemoryBytes, int maxCachedStates) {
+   size_t builtBytes = getMemoryUsage();
+   size_t fittingStates = static_cast<size_t>(lazyDfa->getCachedStateCount());
+   if (maxMemoryBytes > builtBytes) {
+      fittingStates += (maxMemoryBytes - builtBytes) / lazyDfa->getCachedStateCost();
+   }
+   if (fittingStates < static_cast<size_t>(CompiledLazyDfa::MIN_MAX_CACHED_STATES)) {
+      kind = COMPILED_NFA_EPSILON;
+      lazyDfa.reset();
+   } else if (fittingStates < static_cast<size_t>(maxCachedStates)) {
+      lazyDfa->setMaxCachedStates(static_cast<int>(fittingStates));
+   }
+}
+
+/*******************************************************************************
+ * Update Lazy DFA
+ * A private helper method to switch from the lazy DFA to the NFA-epsilon once
+ * the cache of the lazy DFA thrashes, and free the cache.
+ */
+void CompiledAutomaton::updateLazyDfa() {
+   if (lazyDfa->isThrashing()) {
+      kind = COMPILED_NFA_EPSILON;
+      lazyDfa.reset();
+   }
+}
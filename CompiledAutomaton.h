@@ -0,0 +1,67 @@
+/*******************************************************************************
+ *  @author             Karl Jansen (kmjansen@uw.edu)
+ *  @version            1.2, 03/16/2015
+ *
+ *  Compilation:        N/A
+ *  Execution:          N/A
+ *  Dependencies:       CompiledDfa.cpp; CompiledLazyDfa.cpp; CompiledNfaEpsilon.cpp;
+ *                      convertNfaEpsilonToDfa.cpp;
+ *
+ *  Description:
+ *  The CompiledAutomaton class represents the fastest compiled automaton for a
+ *  NFA-epsilon that can be built within a ConversionBudget.
+ *
+ *  Functionality:
+ *  This class allows recognition checks to be performed on an input string,
+ *  and reports which kind of automaton was chosen and why.
+ *
+*******************************************************************************/
+
+#ifndef COMPILEDAUTOMATON_H
+#define COMPILEDAUTOMATON_H
+
+#include "CompiledDfa.h"
+#include "CompiledLazyDfa.h"
+#include "CompiledNfaEpsilon.h"
+#include "convertNfaEpsilonToDfa.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+// The kinds of compiled automata a CompiledAutomaton can choose
+enum AutomatonKind { COMPILED_DFA, COMPILED_LAZY_DFA, COMPILED_NFA_EPSILON };
+
+class CompiledAutomaton {
+   public:
+      CompiledAutomaton(const FiniteStateMachine&, const ConversionBudget&);
+
+      bool isRecognized(const std::string&);    // is recognized method
+      bool isRecognized(const std::vector<int>&);  // for wide symbols
+      AutomatonKind getKind() const;
+      ConversionStatus getConversionStatus() const;
+      double getConversionSeconds() const;
+      size_t getMemoryUsage() const;            // get memory usage method
+
+   private:
+      CompiledAutomaton();                      // default constructor
+      CompiledAutomaton(const CompiledAutomaton&);  // not copyable
+      CompiledAutomaton& operator=(const CompiledAutomaton&);
+
+      // the kind chosen, and the outcome of the conversion that decided it
+      AutomatonKind kind;
+      ConversionStatus conversionStatus;
+      double conversionSeconds;
+      // the compiled automaton of the chosen kind, leaving the others empty,
+      // except that a lazy DFA keeps a NFA-epsilon to switch to if it thrashes
+      std::unique_ptr<CompiledDfa> dfa;
+      std::unique_ptr<CompiledLazyDfa> lazyDfa;
+      std::unique_ptr<CompiledNfaEpsilon> nfaEpsilon;
+
+      // helper methods
+      bool hasOnlyByteTransitions(const FiniteStateMachine&) const;
+      void limitLazyDfaMemory(size_t, int);
+      void updateLazyDfa();
+
+};
+
+#endif
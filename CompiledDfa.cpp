@@ -12,58 +12,159 @@
  *  Functionality:
  *  This class creates a compiled version of a Deterministic Finite Automaton
  *  which allows for O(k) evaluation and recognition of a string where k is the
- *  length of the input string.
+ *  length of the input string. Bytes that no transition tells apart share a
+ *  byte class, and every step is one lookup in a table with a row per state
+ *  and a column per byte class. The table stores 8, 16, or 32 bit state IDs,
+ *  whichever is the narrowest that fits the number of states, and state 0 is
+ *  a dead state whose row leads back to itself. Symbols above 255 are matched
+ *  by a binary search in the ranges leaving each state, which are only kept
+ *  when the DFA has transitions on such symbols. Byte inputs are first
+ *  checked against a Prefilter extracted from the DFA, which rejects most
+ *  inputs that cannot be recognized without stepping through them, and lets
+ *  recognition start after the prefix every recognized string shares.
+ *  Recognition does not change the object, so threads can share one.
  *
  *  Assumptions:
  *  A valid DFA FiniteStateMachine is passed into the constructor. This means
- *  that every unique pair of source node and transition character has exactly
- *  one corresponding destination node, and there are exactly zero epsilon
- *  transitions.
+ *  that every unique pair of source node and transition character has at most
+ *  one corresponding destination node, so the ranges leaving each node are
+ *  disjoint, and there are exactly zero epsilon transitions.
  *
 *******************************************************************************/
 
 #include "CompiledDfa.h"
+#include <algorithm>
+#include <bitset>
+#include <climits>
 
 /*******************************************************************************
  * Overloaded Constructor
  * This is public, and creates a Deterministic Finite Automaton (DFA) that can
  * be used to recognize strings. It takes in a valid Finite State Machine, and
  * sets up a local representation of the system for efficient use in the
- * evaluate method.
+ * evaluate method. The FSM is not kept after construction.
  * @param finiteStateMachine
  *                      a valid FiniteStateMachine
  */
-CompiledDfa::CompiledDfa(FiniteStateMachine& originalFiniteStateMachine) {
-   // Update Private Member Variables
-   internalFiniteStateMachine = originalFiniteStateMachine;
-   // Update Internal Representation
-   for (const auto& transition : internalFiniteStateMachine.transitions) {
-      addTransitionToGraph(transition);
+CompiledDfa::CompiledDfa(const FiniteStateMachine& originalFiniteStateMachine)
+   : prefilter(originalFiniteStateMachine) {
+   // The prefilter has checked that every symbol is EPSILON or non-negative
+   // Number the states densely after the dead state
+   MapNodeToStateIndex stateIndices;
+   stateCount = DEAD_STATE + 1;
+   startState = getStateIndex(stateIndices, stateCount, originalFiniteStateMachine.startNode);
+   for (int node : originalFiniteStateMachine.nodes) {
+      getStateIndex(stateIndices, stateCount, node);
+   }
+   for (int node : originalFiniteStateMachine.goalNodes) {
+      getStateIndex(stateIndices, stateCount, node);
+   }
+   for (const auto& transition : originalFiniteStateMachine.transitions) {
+      getStateIndex(stateIndices, stateCount, transition.source);
+      getStateIndex(stateIndices, stateCount, transition.destination);
    }
+   goalStates.assign(stateCount, false);
+   for (int node : originalFiniteStateMachine.goalNodes) {
+      goalStates[stateIndices.at(node)] = true;
+   }
+   // Update Internal Representation
+   addTransitionsToByteTable(originalFiniteStateMachine, stateIndices);
+   addTransitionsToGraph(originalFiniteStateMachine, stateIndices);
+   isPrefilterEnabled = true;
+   updatePrefixState();
 }
 
 /*******************************************************************************
  * Is Recognized
  * This public method tries to recognize an input string with the internal
- * representation of the FSM provided in the constructor. It takes O(nk) time
- * to complete this process, where k is the length of the input string and n is
- * the number of nodes in the FSM.
- * @param inputStr      a string to check with this DFA
+ * representation of the FSM provided in the constructor. It takes O(k) time
+ * to complete this process, where k is the length of the input string.
+ * @param inputStr      a string to check with this DFA, one byte per symbol
  * @return              true if the input string is recognized
  *                      false if the input string is not recognized
  */
-bool CompiledDfa::isRecognized(std::string stringToTest) {
-   int currentState = internalFiniteStateMachine.startNode;
-   // Loop through the input string, checking for recognition
-   for (int i = 0; i < stringToTest.length(); i++) {
-      if (currentState == -1) {
+bool CompiledDfa::isRecognized(const std::string& stringToTest) const {
+   int currentState = startState;
+   size_t i = 0;
+   if (isPrefilterEnabled) {
+      if (!prefilter.mayMatch(stringToTest)) {
          return false;
       }
-      processNextCharacter(stringToTest[i], currentState);
+      // The input starts with the required prefix, so skip past it
+      currentState = prefixState;
+      i = prefilter.getRequiredPrefix().length();
+   }
+   // Loop through the input string in the table with the narrowest state IDs
+   if (!byteTable8.empty()) {
+      return isRecognizedByTable(byteTable8, stringToTest, i, currentState);
+   }
+   if (!byteTable16.empty()) {
+      return isRecognizedByTable(byteTable16, stringToTest, i, currentState);
+   }
+   return isRecognizedByTable(byteTable32, stringToTest, i, currentState);
+}
+
+/*******************************************************************************
+ * Is Recognized
+ * This public method tries to recognize a sequence of wide symbols (Unicode
+ * code points or integer tokens) with the internal representation of the FSM
+ * provided in the constructor. It takes O(k log d) time to complete this
+ * process, where k is the number of symbols in the input sequence and d is
+ * the largest number of ranges above 255 leaving a single state.
+ * @param symbolsToTest a sequence of non-negative symbols to check
+ * @return              true if the input sequence is recognized
+ *                      false if the input sequence is not recognized
+ */
+bool CompiledDfa::isRecognized(const std::vector<int>& symbolsToTest) const {
+   int currentState = startState;
+   // Loop through the input symbols, checking for recognition
+   for (int symbol : symbolsToTest) {
+      if (currentState == DEAD_STATE) {
+         return false;
+      }
+      processNextCharacter(symbol, currentState);
    }
    return isGoalState(currentState);
 }
 
+/*******************************************************************************
+ * Get Memory Usage
+ * This public method returns the number of bytes used by this compiled DFA:
+ * the size of the object itself plus every buffer it owns on the heap.
+ * @return              the number of bytes used
+ */
+size_t CompiledDfa::getMemoryUsage() const {
+   return sizeof(CompiledDfa) - sizeof(Prefilter) + prefilter.getMemoryUsage() +
+          byteTable8.capacity() * sizeof(uint8_t) +
+          byteTable16.capacity() * sizeof(uint16_t) +
+          byteTable32.capacity() * sizeof(uint32_t) +
+          dfaGraphOffsets.capacity() * sizeof(int) +
+          dfaGraph.capacity() * sizeof(DfaRange) +
+          goalStates.capacity() / CHAR_BIT;
+}
+
+/*******************************************************************************
+ * Set Prefilter
+ * This public method replaces the prefilter extracted from the DFA, such as
+ * with one extracted from the NFA-epsilon the DFA was converted from, which
+ * usually finds longer literals.
+ * @param newPrefilter  a prefilter extracted from an equivalent FSM
+ */
+void CompiledDfa::setPrefilter(const Prefilter& newPrefilter) {
+   prefilter = newPrefilter;
+   updatePrefixState();
+}
+
+/*******************************************************************************
+ * Set Prefilter Enabled
+ * This public method turns the prefilter check of byte inputs on or off. It
+ * is on by default.
+ * @param isEnabled     whether byte inputs are checked by the prefilter
+ */
+void CompiledDfa::setPrefilterEnabled(bool isEnabled) {
+   isPrefilterEnabled = isEnabled;
+}
+
 /*******************************************************************************
  * Default Constructor
  * This is private, and cannot be accessed by a client using this class.
@@ -73,15 +174,111 @@ CompiledDfa::CompiledDfa() {
 }
 
 /*******************************************************************************
- * Add Transition to Graph
- * A private helper method to add a transition from the original finite state
- * machine to the internal representation of the compiled DFA.
- * @param transitionToAdd
- *                      a Transition to add to the graph
+ * Add Transitions to Byte Table
+ * A private helper method to split the bytes into classes at every boundary
+ * of a transition range, and to fill in the byte table from the transitions
+ * of the original finite state machine on bytes.
+ * @param finiteStateMachine
+ *                      the original finite state machine
+ * @param stateIndices  the state index of every node
  */
-void CompiledDfa::addTransitionToGraph(Transition transitionToAdd) {
-   TransitionPair currentTransitionPair(transitionToAdd.source, transitionToAdd.transitionChar);
-   dfaGraph[currentTransitionPair] = transitionToAdd.destination;
+void CompiledDfa::addTransitionsToByteTable(const FiniteStateMachine& originalFiniteStateMachine,
+                                            const MapNodeToStateIndex& stateIndices) {
+   std::bitset<257> isClassStart;
+   isClassStart.set(0);
+   for (const auto& transition : originalFiniteStateMachine.transitions) {
+      if (transition.transitionChar >= 0 && transition.transitionChar <= 255) {
+         isClassStart.set(transition.transitionChar);
+         isClassStart.set(std::min(transition.getLastTransitionChar(), 255) + 1);
+      }
+   }
+   int byteClass = -1;
+   for (int byte = 0; byte <= 255; byte++) {
+      if (isClassStart[byte]) {
+         byteClass++;
+      }
+      byteClasses[byte] = static_cast<unsigned char>(byteClass);
+   }
+   byteClassCount = byteClass + 1;
+   // Fill in a wide table, then narrow it to the state ID type that fits
+   std::vector<uint32_t> byteTable(static_cast<size_t>(stateCount) * byteClassCount,
+                                   static_cast<uint32_t>(DEAD_STATE));
+   for (const auto& transition : originalFiniteStateMachine.transitions) {
+      if (transition.transitionChar < 0 || transition.transitionChar > 255) {
+         continue;
+      }
+      size_t row = static_cast<size_t>(stateIndices.at(transition.source)) * byteClassCount;
+      int lastClass = byteClasses[std::min(transition.getLastTransitionChar(), 255)];
+      for (int column = byteClasses[transition.transitionChar]; column <= lastClass; column++) {
+         byteTable[row + column] = stateIndices.at(transition.destination);
+      }
+   }
+   if (stateCount <= UINT8_MAX + 1) {
+      byteTable8.assign(byteTable.cbegin(), byteTable.cend());
+   } else if (stateCount <= UINT16_MAX + 1) {
+      byteTable16.assign(byteTable.cbegin(), byteTable.cend());
+   } else {
+      byteTable32.swap(byteTable);
+   }
+}
+
+/*******************************************************************************
+ * Add Transitions to Graph
+ * A private helper method to add the transitions from the original finite
+ * state machine on symbols above 255 to the internal representation of the
+ * compiled DFA. The ranges are bucketed by source state and then sorted by
+ * first symbol. Nothing is kept if there are no such transitions.
+ * @param finiteStateMachine
+ *                      the original finite state machine
+ * @param stateIndices  the state index of every node
+ */
+void CompiledDfa::addTransitionsToGraph(const FiniteStateMachine& originalFiniteStateMachine,
+                                        const MapNodeToStateIndex& stateIndices) {
+   std::vector<Transition> wideTransitions;
+   for (Transition transition : originalFiniteStateMachine.transitions) {
+      if (transition.getLastTransitionChar() > 255) {
+         transition.source = stateIndices.at(transition.source);
+         transition.destination = stateIndices.at(transition.destination);
+         wideTransitions.push_back(transition);
+      }
+   }
+   if (wideTransitions.empty()) {
+      return;
+   }
+   std::vector<int> transitionIndices;
+   bucketTransitions(wideTransitions, stateCount, true, dfaGraphOffsets, transitionIndices);
+   dfaGraph.resize(transitionIndices.size());
+   for (size_t i = 0; i < transitionIndices.size(); i++) {
+      const Transition& transition = wideTransitions[transitionIndices[i]];
+      dfaGraph[i].first = std::max(transition.transitionChar, 256);
+      dfaGraph[i].last = transition.getLastTransitionChar();
+      dfaGraph[i].destination = transition.destination;
+   }
+   for (size_t i = 0; i + 1 < dfaGraphOffsets.size(); i++) {
+      std::sort(dfaGraph.begin() + dfaGraphOffsets[i], dfaGraph.begin() + dfaGraphOffsets[i + 1],
+                [](const DfaRange& left, const DfaRange& right) {
+                   return left.first < right.first;
+                });
+   }
+}
+
+/*******************************************************************************
+ * Get Byte Table State
+ * A private helper method to look up the state a byte leads to from a state in
+ * whichever byte table is in use.
+ * @param state         a state index
+ * @param byte          a byte from 0 to 255
+ * @return              the state index of the destination
+ */
+int CompiledDfa::getByteTableState(int state, int byte) const {
+   size_t entry = static_cast<size_t>(state) * byteClassCount + byteClasses[byte];
+   if (!byteTable8.empty()) {
+      return byteTable8[entry];
+   }
+   if (!byteTable16.empty()) {
+      return byteTable16[entry];
+   }
+   return static_cast<int>(byteTable32[entry]);
 }
 
 /*******************************************************************************
@@ -90,29 +287,79 @@ void CompiledDfa::addTransitionToGraph(Transition transitionToAdd) {
  * the set of goal states for the finite state machine.
  * @param states        an int representing a state
  */
-bool CompiledDfa::isGoalState(int state) {
-   if (internalFiniteStateMachine.goalNodes.count(state) > 0) {
-      return true;
+bool CompiledDfa::isGoalState(int state) const {
+   return goalStates[state];
+}
+
+/*******************************************************************************
+ * Is Recognized by Table
+ * A private helper method to run the rest of an input string through a byte
+ * table, starting from a given position and state.
+ * @param byteTable     the byte table in use
+ * @param inputStr      a string to check, one byte per symbol
+ * @param position      the position of the first byte to process
+ * @param currentState  the state reached before that byte
+ * @return              true if the input string is recognized
+ */
+template <typename StateId>
+bool CompiledDfa::isRecognizedByTable(const std::vector<StateId>& byteTable,
+                                      const std::string& stringToTest, size_t position,
+                                      int currentState) const {
+   const StateId* table = byteTable.data();
+   const unsigned char* input = reinterpret_cast<const unsigned char*>(stringToTest.data());
+   size_t length = stringToTest.length();
+   size_t state = currentState;
+   for (; position < length; position++) {
+      if (state == DEAD_STATE) {
+         return false;
+      }
+      state = table[state * byteClassCount + byteClasses[input[position]]];
    }
-   return false;
+   return goalStates[state];
 }
 
 /*******************************************************************************
  * Process Next Character
  * A private helper method to process the next character in the input string
- * during the recognition algorithm. The method updates the current set of
- * states based on a valid transition from a current state on the transition
- * character being processed from the input string.
+ * during the recognition algorithm. Bytes are looked up in the byte table, and
+ * larger symbols are found by a binary search of the ranges leaving the
+ * current state.
  * @param characterToProcess
  *                      the next character in the input string to recognize
- * @param currentStates a reference to a set of the current states
+ * @param currentState  a reference to the current state
  */
-void CompiledDfa::processNextCharacter(char characterToProcess, 
-                                       int& currentState) {
-   TransitionPair testTransitionPair(currentState, characterToProcess);
-   if (dfaGraph.count(testTransitionPair) > 0) {
-      currentState = dfaGraph.at(testTransitionPair);
+void CompiledDfa::processNextCharacter(int characterToProcess, 
+                                       int& currentState) const {
+   if (characterToProcess >= 0 && characterToProcess <= 255) {
+      currentState = getByteTableState(currentState, characterToProcess);
+      return;
+   }
+   if (characterToProcess < 0 || dfaGraph.empty()) {
+      currentState = DEAD_STATE;
+      return;
+   }
+   DfaRangeVector::const_iterator firstRange = dfaGraph.cbegin() + dfaGraphOffsets[currentState];
+   DfaRangeVector::const_iterator lastRange = dfaGraph.cbegin() + dfaGraphOffsets[currentState + 1];
+   DfaRangeVector::const_iterator rangeItr =
+      std::upper_bound(firstRange, lastRange, characterToProcess,
+                       [](int character, const DfaRange& range) {
+                          return character < range.first;
+                       });
+   if (rangeItr != firstRange && (--rangeItr)->last >= characterToProcess) {
+      currentState = rangeItr->destination;
    } else {
-      currentState = -1;
+      currentState = DEAD_STATE;
+   }
+}
+
+/*******************************************************************************
+ * Update Prefix State
+ * A private helper method to find the state reached from the start state by
+ * the required prefix of the prefilter.
+ */
+void CompiledDfa::updatePrefixState() {
+   prefixState = startState;
+   for (char character : prefilter.getRequiredPrefix()) {
+      prefixState = getByteTableState(prefixState, static_cast<unsigned char>(character));
    }
 }
@@ -4,7 +4,7 @@
  *
  *  Compilation:        N/A
  *  Execution:          N/A
- *  Dependencies:       FiniteStateMachine.cpp;
+ *  Dependencies:       FiniteStateMachine.cpp; Prefilter.cpp; indexStates.cpp;
  *
  *  Description:
  *  The CompiledDfa class represents a Deterministic Finite Automaton.
@@ -18,30 +18,71 @@
 #define COMPILEDDFA_H
 
 #include "FiniteStateMachine.cpp"
-#include <unordered_map>
+#include "indexStates.cpp"
+#include "Prefilter.cpp"
+#include <cstdint>
+#include <string>
 #include <unordered_set>
+#include <vector>
+
+// A range labeled transition between two states of the compiled DFA
+struct DfaRange {
+   int first;                                   // first symbol of the range
+   int last;                                    // last symbol of the range
+   int destination;                             // index of destination state
+};
 
 typedef std::unordered_set<int> UnorderedIntSet;
-typedef std::unordered_map<TransitionPair, int, hashTransitionPair> MapTransitionPairToDestination;
+typedef std::vector<DfaRange> DfaRangeVector;
 
 class CompiledDfa {
    public:
-      CompiledDfa(FiniteStateMachine&);         // overloaded constructor
+      CompiledDfa(const FiniteStateMachine&);   // overloaded constructor
    
-      bool isRecognized(std::string);           // is recognized method
+      bool isRecognized(const std::string&) const;  // is recognized method
+      bool isRecognized(const std::vector<int>&) const;  // for wide symbols
+      size_t getMemoryUsage() const;            // get memory usage method
+      void setPrefilter(const Prefilter&);      // set prefilter method
+      void setPrefilterEnabled(bool);           // set prefilter enabled method
 
    private:
       CompiledDfa();                            // default constructor
    
-      // internal FiniteStateMachine
-      FiniteStateMachine internalFiniteStateMachine;
-      // internal representation of the compiled DFA as a map
-      MapTransitionPairToDestination dfaGraph;
+      // the dead state, which every state index is above
+      static const int DEAD_STATE = 0;
+      // number of states, including the dead state
+      int stateCount;
+      // internal representation of the compiled DFA for bytes as a table with
+      // one row per state and one column per byte class, stored with the
+      // narrowest state ID type that fits the number of states
+      unsigned char byteClasses[256];
+      int byteClassCount;
+      std::vector<uint8_t> byteTable8;
+      std::vector<uint16_t> byteTable16;
+      std::vector<uint32_t> byteTable32;
+      // internal representation of the compiled DFA for symbols above 255 as
+      // the sorted ranges of every state, where state i owns
+      // dfaGraph[offsets[i], offsets[i + 1]), left empty if there are none
+      std::vector<int> dfaGraphOffsets;
+      DfaRangeVector dfaGraph;
+      // goal flag and start state by state index
+      std::vector<bool> goalStates;
+      int startState;
+      // checks that reject byte inputs before they are run, and the state
+      // reached from the start state by the prefix every input must have
+      Prefilter prefilter;
+      bool isPrefilterEnabled;
+      int prefixState;
    
       // helper methods
-      void addTransitionToGraph(Transition);
-      bool isGoalState(int);
-      void processNextCharacter(char, int&);
+      void addTransitionsToByteTable(const FiniteStateMachine&, const MapNodeToStateIndex&);
+      void addTransitionsToGraph(const FiniteStateMachine&, const MapNodeToStateIndex&);
+      int getByteTableState(int, int) const;
+      bool isGoalState(int) const;
+      template <typename StateId>
+      bool isRecognizedByTable(const std::vector<StateId>&, const std::string&, size_t, int) const;
+      void processNextCharacter(int, int&) const;
+      void updatePrefixState();
 
 };
 
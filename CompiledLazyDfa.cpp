@@ -0,0 +1,418 @@
+/*******************************************************************************
+ *  @author             Karl Jansen (kmjansen@uw.edu)
+ *  @version            1.2, 03/16/2015
+ *
+ *  Compilation:        N/A
+ *  Execution:          N/A
+ *  Dependencies:       NONE;
+ *
+ *  Purpose:
+ *  This is the implementation of the CompiledLazyDfa class.
+ *
+ *  Functionality:
+ *  This class runs the subset construction of convertNfaEpsilonToDfa one
+ *  transition at a time, only for the transitions the inputs follow. Each DFA
+ *  state is a sorted set of NFA-epsilon states, and each step is one lookup in
+ *  a table with a row per cached state and a column per byte class, as in
+ *  CompiledDfa. A missing entry is filled in by finding the next set of
+ *  NFA-epsilon states, so an input only pays for the subset construction the
+ *  first time it reaches a state it has not seen before. Once the cache holds
+ *  the most states it may, it is flushed and started again from the dead and
+ *  start states, so the memory stays bounded however many states the full DFA
+ *  would have. A cache that is flushed before it has scanned a few bytes per
+ *  state it held is reported as thrashing, since the inputs then spend most
+ *  of their time building states, and a CompiledNfaEpsilon would be faster.
+ *  Byte inputs are first checked against a Prefilter extracted from the
+ *  NFA-epsilon.
+ *
+ *  Assumptions:
+ *  A valid NFA-epsilon FiniteStateMachine whose transitions are all on bytes
+ *  (0-255) is passed into the constructor, which throws std::invalid_argument
+ *  otherwise. Recognition fills in the cache, so a CompiledLazyDfa must not be
+ *  shared between threads.
+ *
+*******************************************************************************/
+
+#include "CompiledLazyDfa.h"
+#include <algorithm>
+#include <bitset>
+#include <climits>
+#include <stdexcept>
+
+/*******************************************************************************
+ * Overloaded Constructor
+ * This is public, and creates a lazy Deterministic Finite Automaton (DFA) that
+ * can be used to recognize strings. It takes in a valid NFA-epsilon Finite
+ * State Machine on bytes, and sets up a local representation of it from which
+ * the DFA states are built on demand. The FSM is not kept after construction.
+ * @param finiteStateMachine
+ *                      a valid NFA-epsilon FiniteStateMachine on bytes
+ * @param maxCachedStates
+ *                      the most DFA states to hold at a time, at least
+ *                      MIN_MAX_CACHED_STATES
+ */
+CompiledLazyDfa::CompiledLazyDfa(const FiniteStateMachine& originalFiniteStateMachine,
+                                 int newMaxCachedStates)
+   : prefilter(originalFiniteStateMachine) {
+   // Number the states densely
+   MapNodeToStateIndex stateIndices;
+   nfaStateCount = 0;
+   int nfaStartState =
+      getStateIndex(stateIndices, nfaStateCount, originalFiniteStateMachine.startNode);
+   for (int node : originalFiniteStateMachine.nodes) {
+      getStateIndex(stateIndices, nfaStateCount, node);
+   }
+   for (int node : originalFiniteStateMachine.goalNodes) {
+      getStateIndex(stateIndices, nfaStateCount, node);
+   }
+   std::vector<Transition> transitions;
+   std::bitset<257> isClassStart;
+   isClassStart.set(0);
+   for (Transition transition : originalFiniteStateMachine.transitions) {
+      transition.source = getStateIndex(stateIndices, nfaStateCount, transition.source);
+      transition.destination = getStateIndex(stateIndices, nfaStateCount, transition.destination);
+      if (transition.transitionChar != EPSILON) {
+         if (transition.transitionChar < 0 || transition.getLastTransitionChar() > 255) {
+            throw std::invalid_argument("CompiledLazyDfa: every transition must be on bytes");
+         }
+         isClassStart.set(transition.transitionChar);
+         isClassStart.set(transition.getLastTransitionChar() + 1);
+      }
+      transitions.push_back(transition);
+   }
+   int byteClass = -1;
+   for (int byte = 0; byte <= 255; byte++) {
+      if (isClassStart[byte]) {
+         byteClass++;
+      }
+      byteClasses[byte] = static_cast<unsigned char>(byteClass);
+   }
+   byteClassCount = byteClass + 1;
+   nfaGoalStates.assign(nfaStateCount, false);
+   for (int node : originalFiniteStateMachine.goalNodes) {
+      nfaGoalStates[stateIndices.at(node)] = true;
+   }
+   // Update Internal Representation
+   addTransitionsToGraph(transitions);
+   nfaStateMarks.assign(nfaStateCount, 0);
+   markStep = 0;
+   startNextStateSet();
+   addNfaState(nfaStartState, nextStateSet);
+   std::sort(nextStateSet.begin(), nextStateSet.end());
+   startStateSet = nextStateSet;
+   flushCount = 0;
+   scannedBytes = 0;
+   flushScannedBytes = 0;
+   isCacheThrashing = false;
+   flushCache();
+   setMaxCachedStates(newMaxCachedStates);
+}
+
+/*******************************************************************************
+ * Is Recognized
+ * This public method tries to recognize an input string with the cached DFA
+ * states, building the states it reaches that are not cached yet. It takes
+ * O(k) time once the states an input reaches are cached, where k is the
+ * length of the input string.
+ * @param inputStr      a string to check with this DFA, one byte per symbol
+ * @return              true if the input string is recognized
+ *                      false if the input string is not recognized
+ */
+bool CompiledLazyDfa::isRecognized(const std::string& stringToTest) {
+   if (!prefilter.mayMatch(stringToTest)) {
+      return false;
+   }
+   scannedBytes += stringToTest.length();
+   int currentState = startState;
+   // Loop through the input string, building the transitions not yet cached
+   for (char character : stringToTest) {
+      if (currentState == DEAD_STATE) {
+         return false;
+      }
+      int column = byteClasses[static_cast<unsigned char>(character)];
+      int nextState = transitionTable[currentState * byteClassCount + column];
+      currentState = nextState != UNKNOWN_STATE ? nextState : getNextState(currentState, column);
+   }
+   return goalStates[currentState];
+}
+
+/*******************************************************************************
+ * Is Recognized
+ * This public method tries to recognize a sequence of symbols like the method
+ * above. Symbols outside 0-255 have no transitions.
+ * @param symbolsToTest a sequence of non-negative symbols to check
+ * @return              true if the input sequence is recognized
+ *                      false if the input sequence is not recognized
+ */
+bool CompiledLazyDfa::isRecognized(const std::vector<int>& symbolsToTest) {
+   scannedBytes += symbolsToTest.size();
+   int currentState = startState;
+   // Loop through the input symbols, building the transitions not yet cached
+   for (int symbol : symbolsToTest) {
+      if (currentState == DEAD_STATE || symbol < 0 || symbol > 255) {
+         return false;
+      }
+      int column = byteClasses[symbol];
+      int nextState = transitionTable[currentState * byteClassCount + column];
+      currentState = nextState != UNKNOWN_STATE ? nextState : getNextState(currentState, column);
+   }
+   return goalStates[currentState];
+}
+
+/*******************************************************************************
+ * Getters
+ * These public methods return the number of DFA states in the cache, and the
+ * number of times the cache was flushed because it was full.
+ */
+int CompiledLazyDfa::getCachedStateCount() const {
+   return cachedStateCount;
+}
+
+int CompiledLazyDfa::getFlushCount() const {
+   return flushCount;
+}
+
+/*******************************************************************************
+ * Get Cached State Cost
+ * This public method returns an upper bound on the bytes the cache grows by
+ * for every DFA state it holds: its row of the transition table, counted
+ * twice since the table may grow to double its size, its set of NFA-epsilon
+ * states, counted as every state and stored both in the sets and as the key
+ * of its map entry, and the map entry, set offset, and goal flag.
+ * @return              the number of bytes per cached state
+ */
+size_t CompiledLazyDfa::getCachedStateCost() const {
+   return 2 * byteClassCount * sizeof(int) + 2 * nfaStateCount * sizeof(int) +
+          sizeof(std::vector<int>) + 2 * sizeof(int) + 3 * sizeof(void*) + 1;
+}
+
+/*******************************************************************************
+ * Get Memory Usage
+ * This public method returns the number of bytes used by this lazy DFA: the
+ * size of the object itself plus every buffer it owns on the heap, with the
+ * map of cached states estimated from its number of entries and buckets.
+ * @return              the number of bytes used
+ */
+size_t CompiledLazyDfa::getMemoryUsage() const {
+   return sizeof(CompiledLazyDfa) - sizeof(Prefilter) + prefilter.getMemoryUsage() +
+          (nfaGoalStates.capacity() + goalStates.capacity()) / CHAR_BIT +
+          (startStateSet.capacity() + nfaGraphOffsets.capacity() + epsilonOffsets.capacity() +
+           epsilonDestinations.capacity() + transitionTable.capacity() +
+           stateSetOffsets.capacity() + 2 * stateSets.capacity() + nextStateSet.capacity() +
+           nfaStateMarks.capacity()) * sizeof(int) +
+          nfaGraph.capacity() * sizeof(LazyNfaRange) +
+          cachedStates.size() * (sizeof(std::vector<int>) + sizeof(int) + 2 * sizeof(void*)) +
+          cachedStates.bucket_count() * sizeof(void*);
+}
+
+/*******************************************************************************
+ * Is Thrashing
+ * This public method determines if the cache was last flushed before it had
+ * scanned MIN_BYTES_PER_STATE bytes for every state it held, in which case
+ * most of the time goes to building states that are soon dropped.
+ * @return              true if the cache is thrashing
+ */
+bool CompiledLazyDfa::isThrashing() const {
+   return isCacheThrashing;
+}
+
+/*******************************************************************************
+ * Set Max Cached States
+ * This public method changes the most DFA states the cache holds at a time,
+ * flushing it if it holds more.
+ * @param maxCachedStates
+ *                      the most DFA states to hold at a time, at least
+ *                      MIN_MAX_CACHED_STATES
+ */
+void CompiledLazyDfa::setMaxCachedStates(int newMaxCachedStates) {
+   maxCachedStates = newMaxCachedStates;
+   if (maxCachedStates < MIN_MAX_CACHED_STATES) {
+      maxCachedStates = MIN_MAX_CACHED_STATES;
+   }
+   if (cachedStateCount > maxCachedStates) {
+      flushCache();
+   }
+}
+
+/*******************************************************************************
+ * Default Constructor
+ * This is private, and cannot be accessed by a client using this class.
+ */
+CompiledLazyDfa::CompiledLazyDfa() {
+   // Empty
+}
+
+/*******************************************************************************
+ * Add Cached State
+ * A private helper method to add a set of NFA-epsilon states to the cache as
+ * a new DFA state, with every transition unknown, or dead for the dead state.
+ * @param stateSet      a sorted set of NFA-epsilon states not in the cache
+ * @return              the new DFA state
+ */
+int CompiledLazyDfa::addCachedState(const std::vector<int>& stateSet) {
+   int state = cachedStateCount++;
+   cachedStates[stateSet] = state;
+   stateSets.insert(stateSets.end(), stateSet.cbegin(), stateSet.cend());
+   stateSetOffsets.push_back(static_cast<int>(stateSets.size()));
+   bool isGoal = false;
+   for (int nfaState : stateSet) {
+      if (nfaGoalStates[nfaState]) {
+         isGoal = true;
+         break;
+      }
+   }
+   goalStates.push_back(isGoal);
+   transitionTable.resize(transitionTable.size() + byteClassCount,
+                          stateSet.empty() ? static_cast<int>(DEAD_STATE) : UNKNOWN_STATE);
+   return state;
+}
+
+/*******************************************************************************
+ * Add NFA State
+ * A private helper method to add a NFA-epsilon state and the states reachable
+ * from it through epsilon transitions to a set of states, skipping the states
+ * already added since the set was started.
+ * @param nfaState      a NFA-epsilon state index
+ * @param states        a reference to the set of states being built
+ */
+void CompiledLazyDfa::addNfaState(int nfaState, std::vector<int>& states) {
+   if (nfaStateMarks[nfaState] == markStep) {
+      return;
+   }
+   size_t closureBegin = states.size();
+   nfaStateMarks[nfaState] = markStep;
+   states.push_back(nfaState);
+   for (size_t i = closureBegin; i < states.size(); i++) {
+      int state = states[i];
+      for (int j = epsilonOffsets[state]; j < epsilonOffsets[state + 1]; j++) {
+         int destination = epsilonDestinations[j];
+         if (nfaStateMarks[destination] != markStep) {
+            nfaStateMarks[destination] = markStep;
+            states.push_back(destination);
+         }
+      }
+   }
+}
+
+/*******************************************************************************
+ * Add Transitions to Graph
+ * A private helper method to bucket the transitions by source state with a
+ * counting sort, keeping the byte transitions as ranges of byte classes
+ * sorted by first class, and the epsilon transitions as destinations.
+ * @param transitions   the transitions, with dense state indices
+ */
+void CompiledLazyDfa::addTransitionsToGraph(const std::vector<Transition>& transitions) {
+   std::vector<Transition> byteTransitions;
+   std::vector<Transition> epsilonTransitions;
+   for (const auto& transition : transitions) {
+      if (transition.transitionChar == EPSILON) {
+         epsilonTransitions.push_back(transition);
+      } else {
+         byteTransitions.push_back(transition);
+      }
+   }
+   std::vector<int> transitionIndices;
+   bucketTransitions(epsilonTransitions, nfaStateCount, true, epsilonOffsets, transitionIndices);
+   epsilonDestinations.resize(transitionIndices.size());
+   for (size_t i = 0; i < transitionIndices.size(); i++) {
+      epsilonDestinations[i] = epsilonTransitions[transitionIndices[i]].destination;
+   }
+   bucketTransitions(byteTransitions, nfaStateCount, true, nfaGraphOffsets, transitionIndices);
+   nfaGraph.resize(transitionIndices.size());
+   for (size_t i = 0; i < transitionIndices.size(); i++) {
+      const Transition& transition = byteTransitions[transitionIndices[i]];
+      nfaGraph[i].firstClass = byteClasses[transition.transitionChar];
+      nfaGraph[i].lastClass = byteClasses[transition.getLastTransitionChar()];
+      nfaGraph[i].destination = transition.destination;
+   }
+   for (int state = 0; state < nfaStateCount; state++) {
+      std::sort(nfaGraph.begin() + nfaGraphOffsets[state],
+                nfaGraph.begin() + nfaGraphOffsets[state + 1],
+                [](const LazyNfaRange& left, const LazyNfaRange& right) {
+                   return left.firstClass < right.firstClass;
+                });
+   }
+}
+
+/*******************************************************************************
+ * Flush Cache
+ * A private helper method to drop every cached DFA state, and add the dead
+ * state and the start state again.
+ */
+void CompiledLazyDfa::flushCache() {
+   cachedStateCount = 0;
+   cachedStates.clear();
+   transitionTable.clear();
+   goalStates.clear();
+   stateSetOffsets.assign(1, 0);
+   stateSets.clear();
+   addCachedState(std::vector<int>());
+   startState = addCachedState(startStateSet);
+}
+
+/*******************************************************************************
+ * Get Cached State
+ * A private helper method to find the DFA state for a set of NFA-epsilon
+ * states, adding it to the cache if it is not there.
+ * @param stateSet      a sorted set of NFA-epsilon states
+ * @return              the DFA state for the set
+ */
+int CompiledLazyDfa::getCachedState(const std::vector<int>& stateSet) {
+   MapStateSetToLazyState::const_iterator stateItr = cachedStates.find(stateSet);
+   if (stateItr != cachedStates.cend()) {
+      return stateItr->second;
+   }
+   return addCachedState(stateSet);
+}
+
+/*******************************************************************************
+ * Get Next State
+ * A private helper method to build the transition of a DFA state on a byte
+ * class that is not cached yet. If the next set of NFA-epsilon states is new
+ * and the cache is full, the cache is flushed first, and the transition is
+ * not cached since its source state is gone.
+ * @param state         a DFA state in the cache
+ * @param byteClass     the byte class to follow
+ * @return              the DFA state reached, which is valid in the cache
+ *                      as it is after the call
+ */
+int CompiledLazyDfa::getNextState(int state, int byteClass) {
+   startNextStateSet();
+   for (int i = stateSetOffsets[state]; i < stateSetOffsets[state + 1]; i++) {
+      int nfaState = stateSets[i];
+      for (int range = nfaGraphOffsets[nfaState];
+           range < nfaGraphOffsets[nfaState + 1] && nfaGraph[range].firstClass <= byteClass;
+           range++) {
+         if (nfaGraph[range].lastClass >= byteClass) {
+            addNfaState(nfaGraph[range].destination, nextStateSet);
+         }
+      }
+   }
+   std::sort(nextStateSet.begin(), nextStateSet.end());
+   if (cachedStateCount >= maxCachedStates && cachedStates.count(nextStateSet) == 0) {
+      flushCount++;
+      isCacheThrashing = scannedBytes - flushScannedBytes <
+                         static_cast<size_t>(MIN_BYTES_PER_STATE) * cachedStateCount;
+      flushScannedBytes = scannedBytes;
+      flushCache();
+      return getCachedState(nextStateSet);
+   }
+   int nextState = getCachedState(nextStateSet);
+   transitionTable[state * byteClassCount + byteClass] = nextState;
+   return nextState;
+}
+
+/*******************************************************************************
+ * Start Next State Set
+ * A private helper method to empty the next set of NFA-epsilon states, and
+ * move to a new mark so that no state counts as added. The marks are reset
+ * before the mark number can overflow.
+ */
+void CompiledLazyDfa::startNextStateSet() {
+   nextStateSet.clear();
+   if (markStep >= INT_MAX / 2) {
+      std::fill(nfaStateMarks.begin(), nfaStateMarks.end(), 0);
+      markStep = 0;
+   }
+   markStep++;
+}
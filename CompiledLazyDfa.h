@@ -0,0 +1,134 @@
+/*******************************************************************************
+ *  @author             Karl Jansen (kmjansen@uw.edu)
+ *  @version            1.2, 03/16/2015
+ *
+ *  Compilation:        N/A
+ *  Execution:          N/A
+ *  Dependencies:       FiniteStateMachine.cpp; Prefilter.cpp; indexStates.cpp;
+ *
+ *  Description:
+ *  The CompiledLazyDfa class represents a Deterministic Finite Automaton that
+ *  is built from a byte-level NFA-epsilon while inputs are recognized.
+ *
+ *  Functionality:
+ *  This class allows recognition checks to be performed on an input string,
+ *  holding at most a fixed number of DFA states at a time.
+ *
+*******************************************************************************/
+
+#ifndef COMPILEDLAZYDFA_H
+#define COMPILEDLAZYDFA_H
+
+#include "FiniteStateMachine.cpp"
+#include "indexStates.cpp"
+#include "Prefilter.cpp"
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// A range of byte classes leaving a state of the NFA-epsilon, and the state it
+// leads to
+struct LazyNfaRange {
+   int firstClass;                              // first byte class of the range
+   int lastClass;                               // last byte class of the range
+   int destination;                             // index of destination state
+};
+
+// Hash Function for the sorted NFA-epsilon states of a lazy DFA state
+struct hashLazyStateSet {
+   size_t operator()(const std::vector<int>& stateSet) const {
+      size_t hashValue = stateSet.size();
+      for (int state : stateSet) {
+         hashValue = hashValue * 31 + std::hash<int>()(state);
+      }
+      return hashValue;
+   }
+};
+
+typedef std::unordered_map<std::vector<int>, int, hashLazyStateSet> MapStateSetToLazyState;
+
+class CompiledLazyDfa {
+   public:
+      // number of DFA states held before the cache is flushed, by default
+      static const int DEFAULT_MAX_CACHED_STATES = 4096;
+      // fewest DFA states the cache may be limited to: the dead state, the
+      // start state, and one more
+      static const int MIN_MAX_CACHED_STATES = 3;
+      // fewest bytes per cached state to scan between flushes of the cache
+      // for it to be worth keeping
+      static const int MIN_BYTES_PER_STATE = 10;
+
+      CompiledLazyDfa(const FiniteStateMachine&, int = DEFAULT_MAX_CACHED_STATES);
+
+      bool isRecognized(const std::string&);    // is recognized method
+      bool isRecognized(const std::vector<int>&);  // for wide symbols
+      int getCachedStateCount() const;
+      size_t getCachedStateCost() const;
+      int getFlushCount() const;
+      size_t getMemoryUsage() const;            // get memory usage method
+      bool isThrashing() const;                 // is thrashing method
+      void setMaxCachedStates(int);
+
+   private:
+      CompiledLazyDfa();                        // default constructor
+
+      // the DFA state for the empty set of NFA-epsilon states
+      static const int DEAD_STATE = 0;
+      // a transition of the cache that has not been followed yet
+      static const int UNKNOWN_STATE = -1;
+      // local epsilon character
+      const int EPSILON = FiniteStateMachine::EPSILON;
+      // number of NFA-epsilon states, goal flag by state index, and the
+      // epsilon closure of the start state
+      int nfaStateCount;
+      std::vector<bool> nfaGoalStates;
+      std::vector<int> startStateSet;
+      // byte class of every byte, split at every boundary of a range
+      unsigned char byteClasses[256];
+      int byteClassCount;
+      // the NFA-epsilon as the ranges of byte classes of every state, sorted
+      // by first class, where state i owns nfaGraph[nfaGraphOffsets[i],
+      // nfaGraphOffsets[i + 1]), and the epsilon destinations of every state,
+      // where state i owns epsilonDestinations[epsilonOffsets[i],
+      // epsilonOffsets[i + 1])
+      std::vector<int> nfaGraphOffsets;
+      std::vector<LazyNfaRange> nfaGraph;
+      std::vector<int> epsilonOffsets;
+      std::vector<int> epsilonDestinations;
+      // the cache of DFA states, where DFA state i is the set of NFA-epsilon
+      // states stateSets[stateSetOffsets[i], stateSetOffsets[i + 1]) and owns
+      // the row of transitionTable from i * byteClassCount
+      int maxCachedStates;
+      int cachedStateCount;
+      int flushCount;
+      int startState;
+      std::vector<int> transitionTable;
+      std::vector<bool> goalStates;
+      std::vector<int> stateSetOffsets;
+      std::vector<int> stateSets;
+      MapStateSetToLazyState cachedStates;
+      // bytes scanned in total and when the cache was last flushed, and
+      // whether that flush came too soon
+      size_t scannedBytes;
+      size_t flushScannedBytes;
+      bool isCacheThrashing;
+      // working memory for building the next set of NFA-epsilon states
+      std::vector<int> nextStateSet;
+      std::vector<int> nfaStateMarks;
+      int markStep;
+      // checks that reject byte inputs before they are run
+      Prefilter prefilter;
+
+      // helper methods
+      int addCachedState(const std::vector<int>&);
+      void addNfaState(int, std::vector<int>&);
+      void addTransitionsToGraph(const std::vector<Transition>&);
+      void flushCache();
+      int getCachedState(const std::vector<int>&);
+      int getNextState(int, int);
+      void startNextStateSet();
+
+};
+
+#endif
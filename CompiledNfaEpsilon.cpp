@@ -10,9 +10,18 @@
  *  This is the implementation of the CompiledNfaEpsilon class.
  *
  *  Functionality:
- *  This class creates a compiled version of a Deterministic Finite Automaton
- *  which allows for O(nk) evaluation and recognition of a string where k is the
- *  length of the input string and n is the number of nodes in the FSM.
+ *  This class creates a compiled version of a Non-Deterministic Finite
+ *  Automaton with Epsilon transitions which allows for O(tk) evaluation and
+ *  recognition of a string where k is the length of the input string and t is
+ *  the number of transitions in the FSM. The transitions are stored in flat
+ *  arrays by dense state index: each state owns a run of sorted, disjoint
+ *  symbol ranges, each range owns a run of destinations, and each state owns
+ *  a run of epsilon destinations. A step is a binary search of the ranges of
+ *  each current state, or one lookup for states with enough ranges to be
+ *  given a dense index over the bytes. Construction buckets the transitions by
+ *  source state, so it is linear in the number of transitions apart from
+ *  sorting the transitions leaving each state. Recognition does not change
+ *  the object, so threads can share one, each passing its own NfaScratch.
  *
  *  Assumptions:
  *  A valid NFA-epsilon FiniteStateMachine is passed into the constructor. This
@@ -23,47 +32,143 @@
 *******************************************************************************/
 
 #include "CompiledNfaEpsilon.h"
+#include <algorithm>
+#include <climits>
 
 /*******************************************************************************
  * Overloaded Constructor
  * This is public, and creates a Non-Deterministic Finite Automaton with Epsilon
  * Transitions (NFA-e) that can be used to recognize strings. It takes in a
  * valid Finite State Machine, and sets up a local representation of the system
- * for efficient use in the evaluate method.
+ * for efficient use in the evaluate method. The FSM is not kept after
+ * construction.
  * @param finiteStateMachine
  *                      a valid FiniteStateMachine
  */
-CompiledNfaEpsilon::CompiledNfaEpsilon(FiniteStateMachine& originalFiniteStateMachine) {
-   // Update Private Member Variables
-   internalFiniteStateMachine = originalFiniteStateMachine;
-   // Update Internal Representation
-   for (const auto& transition : internalFiniteStateMachine.transitions) {
-      addTransitionToGraph(transition);
+CompiledNfaEpsilon::CompiledNfaEpsilon(const FiniteStateMachine& originalFiniteStateMachine) {
+   originalFiniteStateMachine.checkSymbols();
+   // Number the states densely
+   MapNodeToStateIndex stateIndices;
+   stateCount = 0;
+   startState = getStateIndex(stateIndices, stateCount, originalFiniteStateMachine.startNode);
+   for (int node : originalFiniteStateMachine.nodes) {
+      getStateIndex(stateIndices, stateCount, node);
+   }
+   for (int node : originalFiniteStateMachine.goalNodes) {
+      getStateIndex(stateIndices, stateCount, node);
+   }
+   std::vector<Transition> symbolTransitions;
+   std::vector<Transition> epsilonTransitions;
+   for (Transition transition : originalFiniteStateMachine.transitions) {
+      transition.source = getStateIndex(stateIndices, stateCount, transition.source);
+      transition.destination = getStateIndex(stateIndices, stateCount, transition.destination);
+      if (transition.transitionChar == EPSILON) {
+         epsilonTransitions.push_back(transition);
+      } else {
+         symbolTransitions.push_back(transition);
+      }
+   }
+   goalStates.assign(stateCount, false);
+   for (int node : originalFiniteStateMachine.goalNodes) {
+      goalStates[stateIndices.at(node)] = true;
    }
+   // Update Internal Representation
+   addTransitionsToGraph(symbolTransitions);
+   addEpsilonTransitionsToGraph(epsilonTransitions);
 }
 
 /*******************************************************************************
  * Is Recognized
  * This public method tries to recognize an input string with the internal
- * representation of the FSM provided in the constructor. It takes O(nk) time
- * to complete this process, where k is the length of the input string and n is
- * the number of nodes in the FSM.
- * @param inputStr      a string to check with this NfaEpsilon
+ * representation of the FSM provided in the constructor. It takes O(tk) time
+ * to complete this process, where k is the length of the input string and t is
+ * the number of transitions in the FSM.
+ * @param inputStr      a string to check with this NfaEpsilon, one byte per
+ *                      symbol
+ * @return              true if the input string is recognized
+ *                      false if the input string is not recognized
+ */
+bool CompiledNfaEpsilon::isRecognized(const std::string& stringToTest) const {
+   NfaScratch scratch;
+   return isRecognized(stringToTest, scratch);
+}
+
+/*******************************************************************************
+ * Is Recognized
+ * This public method tries to recognize a sequence of wide symbols (Unicode
+ * code points or integer tokens) with the internal representation of the FSM
+ * provided in the constructor. It takes O(tk) time to complete this process,
+ * where k is the number of symbols in the input sequence and t is the number
+ * of transitions in the FSM.
+ * @param symbolsToTest a sequence of non-negative symbols to check
+ * @return              true if the input sequence is recognized
+ *                      false if the input sequence is not recognized
+ */
+bool CompiledNfaEpsilon::isRecognized(const std::vector<int>& symbolsToTest) const {
+   NfaScratch scratch;
+   return isRecognized(symbolsToTest, scratch);
+}
+
+/*******************************************************************************
+ * Is Recognized
+ * This public method tries to recognize an input string like the method above,
+ * but works in the memory of a scratch that the caller keeps between calls.
+ * Concurrent calls are safe as long as each thread uses its own scratch.
+ * @param inputStr      a string to check with this NfaEpsilon, one byte per
+ *                      symbol
+ * @param scratch       a reference to the working memory of the caller
  * @return              true if the input string is recognized
  *                      false if the input string is not recognized
  */
-bool CompiledNfaEpsilon::isRecognized(std::string stringToTest) {
-   UnorderedIntSet currentStates;
-   currentStates.insert(internalFiniteStateMachine.startNode);
-   getEpsilonClosure(currentStates);
+bool CompiledNfaEpsilon::isRecognized(const std::string& stringToTest,
+                                      NfaScratch& scratch) const {
+   startRecognition(scratch);
    // Loop through the input string, checking for recognition
-   for (int i = 0; i < stringToTest.length(); i++) {
-      if (currentStates.empty()) {
+   for (size_t i = 0; i < stringToTest.length(); i++) {
+      if (scratch.currentStates.empty()) {
          return false;
       }
-      processNextCharacter(stringToTest[i], currentStates);
+      processNextCharacter(static_cast<unsigned char>(stringToTest[i]), scratch);
    }
-   return isGoalState(currentStates);
+   return isGoalState(scratch.currentStates);
+}
+
+/*******************************************************************************
+ * Is Recognized
+ * This public method tries to recognize a sequence of wide symbols like the
+ * method above, but works in the memory of a scratch that the caller keeps
+ * between calls.
+ * @param symbolsToTest a sequence of non-negative symbols to check
+ * @param scratch       a reference to the working memory of the caller
+ * @return              true if the input sequence is recognized
+ *                      false if the input sequence is not recognized
+ */
+bool CompiledNfaEpsilon::isRecognized(const std::vector<int>& symbolsToTest,
+                                      NfaScratch& scratch) const {
+   startRecognition(scratch);
+   // Loop through the input symbols, checking for recognition
+   for (int symbol : symbolsToTest) {
+      if (scratch.currentStates.empty()) {
+         return false;
+      }
+      processNextCharacter(symbol, scratch);
+   }
+   return isGoalState(scratch.currentStates);
+}
+
+/*******************************************************************************
+ * Get Memory Usage
+ * This public method returns the number of bytes used by this compiled
+ * NFA-epsilon: the size of the object itself plus every buffer it owns on the
+ * heap.
+ * @return              the number of bytes used
+ */
+size_t CompiledNfaEpsilon::getMemoryUsage() const {
+   return sizeof(CompiledNfaEpsilon) + goalStates.capacity() / CHAR_BIT +
+          (nfaGraphOffsets.capacity() + destinations.capacity() + epsilonOffsets.capacity() +
+           epsilonDestinations.capacity() + denseIndexSlots.capacity() +
+           denseIndex.capacity()) * sizeof(int) +
+          nfaGraph.capacity() * sizeof(NfaRange);
 }
 
 /*******************************************************************************
@@ -75,57 +180,224 @@ CompiledNfaEpsilon::CompiledNfaEpsilon() {
 }
 
 /*******************************************************************************
- * Add Transition to Graph
- * A private helper method to add a transition from the original finite state
- * machine to the internal representation of the compiled NFA-epsilon.
- * @param transitionToAdd
- *                      a Transition to add to the graph
+ * Add Epsilon Transitions to Graph
+ * A private helper method to bucket the epsilon transitions by source state,
+ * keeping each destination of a state once.
+ * @param epsilonTransitions
+ *                      the epsilon transitions, with dense state indices
  */
-void CompiledNfaEpsilon::addTransitionToGraph(Transition transitionToAdd) {
-   TransitionPair currentTransitionPair(transitionToAdd.source, transitionToAdd.transitionChar);
-   UnorderedIntSet destinations;
-   if (nfaEpsilonGraph.count(currentTransitionPair) > 0) {
-      destinations = nfaEpsilonGraph.at(currentTransitionPair);
+void CompiledNfaEpsilon::addEpsilonTransitionsToGraph(const std::vector<Transition>& epsilonTransitions) {
+   if (epsilonTransitions.empty()) {
+      return;
    }
-   destinations.insert(transitionToAdd.destination);
-   nfaEpsilonGraph[currentTransitionPair] = destinations;
+   std::vector<int> offsets;
+   std::vector<int> transitionIndices;
+   bucketTransitions(epsilonTransitions, stateCount, true, offsets, transitionIndices);
+   std::vector<int> bucketedDestinations;
+   bucketedDestinations.reserve(transitionIndices.size());
+   for (int transitionIndex : transitionIndices) {
+      bucketedDestinations.push_back(epsilonTransitions[transitionIndex].destination);
+   }
+   epsilonOffsets.assign(stateCount + 1, 0);
+   for (int state = 0; state < stateCount; state++) {
+      std::vector<int>::iterator first = bucketedDestinations.begin() + offsets[state];
+      std::vector<int>::iterator last = bucketedDestinations.begin() + offsets[state + 1];
+      std::sort(first, last);
+      epsilonDestinations.insert(epsilonDestinations.end(), first, std::unique(first, last));
+      epsilonOffsets[state + 1] = static_cast<int>(epsilonDestinations.size());
+   }
+   epsilonDestinations.shrink_to_fit();
 }
 
 /*******************************************************************************
- * Get Epsilon Closure
- * A private helper method to add nodes to the current state if an epsilon
- * transition exists.
- * @param states        a reference to a set of states
- */
-void CompiledNfaEpsilon::getEpsilonClosure(UnorderedIntSet& states) {
-   int inserts = 0;
-   for (auto sourceState : states) {
-      TransitionPair epsilonTransitionPair(sourceState, EPSILON);
-      if (nfaEpsilonGraph.count(epsilonTransitionPair) > 0) {
-         for (const auto& destinationState : nfaEpsilonGraph.at(epsilonTransitionPair)) {
-            if (states.count(destinationState) == 0) {
-               states.insert(destinationState);
-               inserts++;
-            }
+ * Add State
+ * A private helper method to add a state to a set of states, unless it was
+ * already added during the current step.
+ * @param state         a state index
+ * @param states        a reference to the states of the current step
+ * @param stateMarks    a reference to the last step each state was added in
+ * @param step          the current step
+ */
+void CompiledNfaEpsilon::addState(int state, std::vector<int>& states,
+                                  std::vector<int>& stateMarks, int step) const {
+   if (stateMarks[state] != step) {
+      stateMarks[state] = step;
+      states.push_back(state);
+   }
+}
+
+/*******************************************************************************
+ * Add State Ranges to Graph
+ * A private helper method to split the transitions leaving one state into
+ * disjoint ranges, each with the sorted destinations of every transition that
+ * covers it, and to add them to the graph. Adjacent ranges with the same
+ * destinations are merged.
+ * @param firstTransition
+ *                      the first transition leaving the state
+ * @param lastTransition
+ *                      one past the last transition leaving the state
+ */
+void CompiledNfaEpsilon::addStateRangesToGraph(std::vector<Transition>::iterator firstTransition,
+                                               std::vector<Transition>::iterator lastTransition) {
+   std::sort(firstTransition, lastTransition,
+             [](const Transition& left, const Transition& right) {
+                return left.transitionChar < right.transitionChar;
+             });
+   std::vector<int> boundaries;
+   for (std::vector<Transition>::iterator transitionItr = firstTransition;
+        transitionItr != lastTransition; ++transitionItr) {
+      boundaries.push_back(transitionItr->transitionChar);
+      boundaries.push_back(transitionItr->getLastTransitionChar() + 1);
+   }
+   std::sort(boundaries.begin(), boundaries.end());
+   boundaries.erase(std::unique(boundaries.begin(), boundaries.end()), boundaries.end());
+   // Sweep the boundaries, keeping the transitions that cover each range
+   size_t stateBegin = nfaGraph.size();
+   std::vector<Transition>::iterator nextTransition = firstTransition;
+   std::vector<Transition> activeTransitions;
+   for (size_t i = 0; i + 1 < boundaries.size(); i++) {
+      int first = boundaries[i];
+      int last = boundaries[i + 1] - 1;
+      while (nextTransition != lastTransition && nextTransition->transitionChar == first) {
+         activeTransitions.push_back(*nextTransition++);
+      }
+      activeTransitions.erase(
+         std::remove_if(activeTransitions.begin(), activeTransitions.end(),
+                        [first](const Transition& transition) {
+                           return transition.getLastTransitionChar() < first;
+                        }),
+         activeTransitions.end());
+      if (activeTransitions.empty()) {
+         continue;
+      }
+      int destinationsBegin = static_cast<int>(destinations.size());
+      for (const auto& transition : activeTransitions) {
+         destinations.push_back(transition.destination);
+      }
+      std::sort(destinations.begin() + destinationsBegin, destinations.end());
+      destinations.erase(std::unique(destinations.begin() + destinationsBegin, destinations.end()),
+                         destinations.end());
+      if (nfaGraph.size() > stateBegin) {
+         NfaRange& previousRange = nfaGraph.back();
+         if (previousRange.last + 1 == first &&
+             previousRange.destinationsEnd - previousRange.destinationsBegin ==
+                static_cast<int>(destinations.size()) - destinationsBegin &&
+             std::equal(destinations.begin() + destinationsBegin, destinations.end(),
+                        destinations.begin() + previousRange.destinationsBegin)) {
+            previousRange.last = last;
+            destinations.resize(destinationsBegin);
+            continue;
+         }
+      }
+      NfaRange range;
+      range.first = first;
+      range.last = last;
+      range.destinationsBegin = destinationsBegin;
+      range.destinationsEnd = static_cast<int>(destinations.size());
+      nfaGraph.push_back(range);
+   }
+}
+
+/*******************************************************************************
+ * Add Transitions to Graph
+ * A private helper method to bucket the transitions on symbols by source state
+ * with a counting sort, add the ranges of every state to the graph, and give
+ * the states with many ranges a dense byte index.
+ * @param symbolTransitions
+ *                      the non-epsilon transitions, with dense state indices
+ */
+void CompiledNfaEpsilon::addTransitionsToGraph(const std::vector<Transition>& symbolTransitions) {
+   std::vector<int> offsets;
+   std::vector<int> transitionIndices;
+   bucketTransitions(symbolTransitions, stateCount, true, offsets, transitionIndices);
+   std::vector<Transition> bucketedTransitions;
+   bucketedTransitions.reserve(transitionIndices.size());
+   for (int transitionIndex : transitionIndices) {
+      bucketedTransitions.push_back(symbolTransitions[transitionIndex]);
+   }
+   nfaGraphOffsets.assign(stateCount + 1, 0);
+   denseIndexSlots.assign(stateCount, -1);
+   for (int state = 0; state < stateCount; state++) {
+      addStateRangesToGraph(bucketedTransitions.begin() + offsets[state],
+                            bucketedTransitions.begin() + offsets[state + 1]);
+      int rangesEnd = static_cast<int>(nfaGraph.size());
+      nfaGraphOffsets[state + 1] = rangesEnd;
+      if (rangesEnd - nfaGraphOffsets[state] < DENSE_INDEX_MIN_RANGES) {
+         continue;
+      }
+      int slot = static_cast<int>(denseIndex.size() / 256);
+      denseIndexSlots[state] = slot;
+      denseIndex.resize(denseIndex.size() + 256, -1);
+      for (int range = nfaGraphOffsets[state]; range < rangesEnd; range++) {
+         int lastByte = std::min(nfaGraph[range].last, 255);
+         for (int byte = nfaGraph[range].first; byte <= lastByte; byte++) {
+            denseIndex[slot * 256 + byte] = range;
          }
       }
    }
-   // If there is a newly reachable epsilon transition
-   // Recursively add more nodes to the set of states 
-   if (inserts > 0) {
-      getEpsilonClosure(states);
+   nfaGraph.shrink_to_fit();
+   destinations.shrink_to_fit();
+   denseIndex.shrink_to_fit();
+}
+
+/*******************************************************************************
+ * Get Epsilon Closure
+ * A private helper method to add the states reachable through epsilon
+ * transitions to a set of states. The set is its own worklist, so each state
+ * is expanded once. An epsilon-free NFA returns immediately, so each step is
+ * only the union of the successor sets.
+ * @param states        a reference to the states of the current step
+ * @param stateMarks    a reference to the last step each state was added in
+ * @param step          the current step
+ */
+void CompiledNfaEpsilon::getEpsilonClosure(std::vector<int>& states,
+                                           std::vector<int>& stateMarks, int step) const {
+   if (epsilonDestinations.empty()) {
+      return;
+   }
+   for (size_t i = 0; i < states.size(); i++) {
+      int state = states[i];
+      for (int j = epsilonOffsets[state]; j < epsilonOffsets[state + 1]; j++) {
+         addState(epsilonDestinations[j], states, stateMarks, step);
+      }
    }
 }
 
+/*******************************************************************************
+ * Get Range Index
+ * A private helper method to find the range leaving a state that holds a
+ * symbol, with the dense byte index of the state if it has one, or a binary
+ * search of its ranges otherwise.
+ * @param state         a state index
+ * @param symbol        the symbol to look up
+ * @return              the index of the range in nfaGraph, or -1 if none
+ */
+int CompiledNfaEpsilon::getRangeIndex(int state, int symbol) const {
+   if (symbol >= 0 && symbol <= 255 && denseIndexSlots[state] != -1) {
+      return denseIndex[denseIndexSlots[state] * 256 + symbol];
+   }
+   NfaRangeVector::const_iterator firstRange = nfaGraph.cbegin() + nfaGraphOffsets[state];
+   NfaRangeVector::const_iterator lastRange = nfaGraph.cbegin() + nfaGraphOffsets[state + 1];
+   NfaRangeVector::const_iterator rangeItr =
+      std::upper_bound(firstRange, lastRange, symbol,
+                       [](int character, const NfaRange& range) {
+                          return character < range.first;
+                       });
+   if (rangeItr != firstRange && (--rangeItr)->last >= symbol) {
+      return static_cast<int>(rangeItr - nfaGraph.cbegin());
+   }
+   return -1;
+}
+
 /*******************************************************************************
  * Is Goal State
  * A private helper method to determine if any of the current states is also in
  * the set of goal states for the finite state machine.
- * @param states        a set of states
+ * @param states        the current states
  */
-bool CompiledNfaEpsilon::isGoalState(UnorderedIntSet states) {
-   for (const auto& state : states) {
-      if (internalFiniteStateMachine.goalNodes.count(state) > 0) {
+bool CompiledNfaEpsilon::isGoalState(const std::vector<int>& states) const {
+   for (int state : states) {
+      if (goalStates[state]) {
          return true;
       }
    }
@@ -140,19 +412,57 @@ bool CompiledNfaEpsilon::isGoalState(UnorderedIntSet states) {
  * character being processed from the input string.
  * @param characterToProcess
  *                      the next character in the input string to recognize
- * @param currentStates a reference to a set of the current states
- */
-void CompiledNfaEpsilon::processNextCharacter(char characterToProcess, 
-                                              UnorderedIntSet& currentStates) {
-   UnorderedIntSet nextStates;
-   for (const auto& sourceState : currentStates) {
-      TransitionPair testTransitionPair(sourceState, characterToProcess);
-      if (nfaEpsilonGraph.count(testTransitionPair) > 0) {
-         for (const auto& destinationState : nfaEpsilonGraph.at(testTransitionPair)) {
-            nextStates.insert(destinationState);
-         }
+ * @param scratch       a reference to the working memory of the recognition
+ */
+void CompiledNfaEpsilon::processNextCharacter(int characterToProcess,
+                                              NfaScratch& scratch) const {
+   int step = startNextStep(scratch);
+   scratch.nextStates.clear();
+   for (int sourceState : scratch.currentStates) {
+      int range = getRangeIndex(sourceState, characterToProcess);
+      if (range == -1) {
+         continue;
       }
+      for (int i = nfaGraph[range].destinationsBegin; i < nfaGraph[range].destinationsEnd; i++) {
+         addState(destinations[i], scratch.nextStates, scratch.stateMarks, step);
+      }
+   }
+   getEpsilonClosure(scratch.nextStates, scratch.stateMarks, step);
+   scratch.currentStates.swap(scratch.nextStates);
+}
+
+/*******************************************************************************
+ * Start Next Step
+ * A private helper method to take a new mark for the next step of a scratch.
+ * The marks are cleared once the step count is about to overflow, which a
+ * long enough input reaches within a single recognition.
+ * @param scratch       a reference to the working memory of the recognition
+ * @return              the mark of the new step
+ */
+int CompiledNfaEpsilon::startNextStep(NfaScratch& scratch) const {
+   if (scratch.step == INT_MAX) {
+      std::fill(scratch.stateMarks.begin(), scratch.stateMarks.end(), -1);
+      scratch.step = 0;
+   }
+   return ++scratch.step;
+}
+
+/*******************************************************************************
+ * Start Recognition
+ * A private helper method to prepare a scratch for a new input, holding the
+ * epsilon closure of the start state. The marks only need to be cleared here
+ * when the scratch is new or too small for this NFA-epsilon, since every step
+ * uses a new mark.
+ * @param scratch       a reference to the working memory of the recognition
+ */
+void CompiledNfaEpsilon::startRecognition(NfaScratch& scratch) const {
+   if (scratch.stateMarks.size() < static_cast<size_t>(stateCount)) {
+      scratch.stateMarks.assign(std::max(scratch.stateMarks.size(),
+                                         static_cast<size_t>(stateCount)), -1);
+      scratch.step = 0;
    }
-   getEpsilonClosure(nextStates);
-   currentStates = nextStates;
+   int step = startNextStep(scratch);
+   scratch.currentStates.clear();
+   addState(startState, scratch.currentStates, scratch.stateMarks, step);
+   getEpsilonClosure(scratch.currentStates, scratch.stateMarks, step);
 }
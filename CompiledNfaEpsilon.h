@@ -4,7 +4,7 @@
  *
  *  Compilation:        N/A
  *  Execution:          N/A
- *  Dependencies:       FiniteStateMachine.cpp;
+ *  Dependencies:       FiniteStateMachine.cpp; indexStates.cpp;
  *
  *  Description:
  *  The CompiledNfaEpsilon class represents a Non-Deterministic Finite Automaton
@@ -19,33 +19,82 @@
 #define COMPILEDNFAEPSILON_H
 
 #include "FiniteStateMachine.cpp"
-#include <unordered_map>
+#include "indexStates.cpp"
+#include <string>
 #include <unordered_set>
+#include <vector>
+
+// A range labeled interval of symbols leaving a state of the compiled
+// NFA-epsilon, and the destinations it leads to
+struct NfaRange {
+   int first;                                   // first symbol of the range
+   int last;                                    // last symbol of the range
+   int destinationsBegin;                       // first index of destinations
+   int destinationsEnd;                         // one past the last index
+};
+
+// Working memory for recognizing inputs with a CompiledNfaEpsilon, which a
+// thread can keep and pass to every call so that no call allocates
+struct NfaScratch {
+   std::vector<int> currentStates;              // states before a step
+   std::vector<int> nextStates;                 // states after a step
+   std::vector<int> stateMarks;                 // last step each state was added
+   int step = 0;                                // steps taken with this scratch
+};
 
 typedef std::unordered_set<int> UnorderedIntSet;
-typedef std::unordered_map<TransitionPair, UnorderedIntSet, hashTransitionPair> MapTransitionPairToDestinations;
+typedef std::vector<NfaRange> NfaRangeVector;
 
 class CompiledNfaEpsilon {
    public:
-      CompiledNfaEpsilon(FiniteStateMachine&);  // overloaded constructor
+      CompiledNfaEpsilon(const FiniteStateMachine&);  // overloaded constructor
    
-      bool isRecognized(std::string);           // is recognized method
+      bool isRecognized(const std::string&) const;  // is recognized method
+      bool isRecognized(const std::vector<int>&) const;  // for wide symbols
+      bool isRecognized(const std::string&, NfaScratch&) const;
+      bool isRecognized(const std::vector<int>&, NfaScratch&) const;
+      size_t getMemoryUsage() const;            // get memory usage method
 
    private:
       CompiledNfaEpsilon();                     // default constructor
    
+      // number of ranges from which a state also gets a dense byte index
+      static const int DENSE_INDEX_MIN_RANGES = 16;
       // local epsilon character
-      const char EPSILON = FiniteStateMachine::EPSILON;
-      // internal FiniteStateMachine
-      FiniteStateMachine internalFiniteStateMachine;
-      // internal representation of the compiled NFA-epsilon as a map
-      MapTransitionPairToDestinations nfaEpsilonGraph;
+      const int EPSILON = FiniteStateMachine::EPSILON;
+      // number of states, goal flag by state index, and start state
+      int stateCount;
+      std::vector<bool> goalStates;
+      int startState;
+      // internal representation of the compiled NFA-epsilon as the sorted,
+      // disjoint ranges of every state, where state i owns
+      // nfaGraph[nfaGraphOffsets[i], nfaGraphOffsets[i + 1]), and the
+      // destinations of every range in one array
+      std::vector<int> nfaGraphOffsets;
+      NfaRangeVector nfaGraph;
+      std::vector<int> destinations;
+      // epsilon destinations of every state, where state i owns
+      // epsilonDestinations[epsilonOffsets[i], epsilonOffsets[i + 1])
+      std::vector<int> epsilonOffsets;
+      std::vector<int> epsilonDestinations;
+      // index into nfaGraph of the range holding each byte, or -1, for the
+      // states with many ranges, where state i owns the 256 entries from
+      // denseIndexSlots[i] * 256, or has no dense index if its slot is -1
+      std::vector<int> denseIndexSlots;
+      std::vector<int> denseIndex;
    
       // helper methods
-      void addTransitionToGraph(Transition);
-      void getEpsilonClosure(UnorderedIntSet&);
-      bool isGoalState(UnorderedIntSet);
-      void processNextCharacter(char, UnorderedIntSet&);
+      void addEpsilonTransitionsToGraph(const std::vector<Transition>&);
+      void addStateRangesToGraph(std::vector<Transition>::iterator,
+                                 std::vector<Transition>::iterator);
+      void addState(int, std::vector<int>&, std::vector<int>&, int) const;
+      void addTransitionsToGraph(const std::vector<Transition>&);
+      void getEpsilonClosure(std::vector<int>&, std::vector<int>&, int) const;
+      int getRangeIndex(int, int) const;
+      bool isGoalState(const std::vector<int>&) const;
+      void processNextCharacter(int, NfaScratch&) const;
+      int startNextStep(NfaScratch&) const;
+      void startRecognition(NfaScratch&) const;
 
 };
 
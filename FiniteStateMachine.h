@@ -11,7 +11,8 @@
  *  Machine.
  *
  *  Functionality:
- *  Provides a publicly accessible data structure.
+ *  Provides a publicly accessible data structure, and a check that its
+ *  transition symbols are in range.
  *
 *******************************************************************************/
 
@@ -19,19 +20,55 @@
 #define FINITESTATEMACHINE_H
 
 #include "Transition.cpp"
+#include <climits>
 #include <list>
+#include <stdexcept>
+#include <string>
 #include <unordered_set>
 
 typedef std::unordered_set<int> UnorderedIntSet;
 
 struct FiniteStateMachine {
 
-   static const char EPSILON = '\0';            // character for epsilon
+   static const int EPSILON = -1;               // out-of-band epsilon symbol
+   static const int MAX_SYMBOL = INT_MAX - 1;   // largest symbol, so that one
+                                                // past a range end fits an int
 
    UnorderedIntSet nodes;                       // set of nodes in FSM
    int startNode;                               // the starting node of the FSM
    UnorderedIntSet goalNodes;                   // the set of goal nodes in FSM
    std::list<Transition> transitions;           // the list of transitions
+
+   // throws std::invalid_argument unless every transition is on EPSILON or
+   // on symbols in [0, MAX_SYMBOL]; the lower bound catches bytes above 127
+   // stored through a signed char, and the upper bound lets the passes split
+   // the alphabet at one past the end of a range. A range must not be
+   // reversed, and an EPSILON transition must not carry one.
+   void checkSymbols() const {
+      for (const auto& transition : transitions) {
+         if (transition.transitionChar < 0 && transition.transitionChar != EPSILON) {
+            throw std::invalid_argument("FiniteStateMachine: negative transition symbol " +
+                                        std::to_string(transition.transitionChar));
+         }
+         if (transition.lastTransitionChar != Transition::SINGLE_CHAR) {
+            if (transition.transitionChar == EPSILON) {
+               throw std::invalid_argument("FiniteStateMachine: epsilon transition with last "
+                                           "symbol " +
+                                           std::to_string(transition.lastTransitionChar));
+            }
+            if (transition.lastTransitionChar < transition.transitionChar) {
+               throw std::invalid_argument("FiniteStateMachine: reversed transition range " +
+                                           std::to_string(transition.transitionChar) + "-" +
+                                           std::to_string(transition.lastTransitionChar));
+            }
+         }
+         if (transition.getLastTransitionChar() > MAX_SYMBOL) {
+            throw std::invalid_argument("FiniteStateMachine: transition symbol " +
+                                        std::to_string(transition.getLastTransitionChar()) +
+                                        " above MAX_SYMBOL");
+         }
+      }
+   }
 };
 
 #endif
@@ -0,0 +1,545 @@
+/*******************************************************************************
+ *  @author             Karl Jansen (kmjansen@uw.edu)
+ *  @version            1.2, 03/16/2015
+ *
+ *  Compilation:        N/A
+ *  Execution:          N/A
+ *  Dependencies:       NONE;
+ *
+ *  Purpose:
+ *  This is the implementation of the Prefilter class.
+ *
+ *  Functionality:
+ *  The analysis works on any FiniteStateMachine, but the literals it finds are
+ *  usually longer on the NFA-epsilon than on the DFA built from it, because a
+ *  leading loop such as .* does not spread into the rest of an NFA. Only the
+ *  nodes on some accepting path are considered. The required literals come
+ *  from the dominators of a sink node that every goal node leads to: each of
+ *  those nodes is on every accepting path, in order, so a run of them that
+ *  can only be left through one byte spells out a literal that every
+ *  recognized string contains. Checking an input takes O(k) time with memchr
+ *  and memcmp, where k is the length of the input string.
+ *
+ *  Assumptions:
+ *  Inputs are checked as bytes, so transitions on symbols above 255 never
+ *  contribute a literal or a first byte.
+ *
+*******************************************************************************/
+
+// Guarded, since the headers of every class that holds a Prefilter include
+// this file
+#ifndef PREFILTER_CPP
+#define PREFILTER_CPP
+
+#include "Prefilter.h"
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <utility>
+
+// Literal steps that are not a byte
+static const int LITERAL_EPSILON_STEP = -1;
+static const int LITERAL_BREAK = -2;
+
+/*******************************************************************************
+ * Default Constructor
+ * This is public, and creates a prefilter that lets every input through.
+ */
+Prefilter::Prefilter() {
+   firstBytes.set();
+   acceptsEmpty = true;
+   minimumLength = 0;
+}
+
+/*******************************************************************************
+ * Overloaded Constructor
+ * This is public, and extracts a prefilter from a Finite State Machine. The
+ * analysis takes O(n * t) time in the worst case, where n is the number of
+ * nodes and t is the number of transitions in the FSM, and close to O(t) for
+ * the automata built from regular expressions.
+ * @param finiteStateMachine
+ *                      a valid FiniteStateMachine of any kind
+ */
+Prefilter::Prefilter(const FiniteStateMachine& finiteStateMachine) {
+   finiteStateMachine.checkSymbols();
+   firstBytes.reset();
+   acceptsEmpty = false;
+   minimumLength = 0;
+   PrefilterGraph graph;
+   buildPrefilterGraph(finiteStateMachine, graph);
+   // An FSM that recognizes nothing lets nothing through
+   if (!graph.isLive[graph.startNode]) {
+      return;
+   }
+   extractFirstBytes(graph);
+   extractMinimumLength(graph);
+   extractRequiredLiterals(graph);
+}
+
+/*******************************************************************************
+ * May Match
+ * This public method checks an input string against the prefilter. A false
+ * result means the FSM cannot recognize the input, while a true result means
+ * the input still has to be run through the automaton.
+ * @param inputStr      a string to check, one byte per symbol
+ * @return              false if the input string cannot be recognized
+ *                      true otherwise
+ */
+bool Prefilter::mayMatch(const std::string& stringToTest) const {
+   size_t length = stringToTest.length();
+   if (length == 0) {
+      return acceptsEmpty;
+   }
+   if (length < minimumLength ||
+       !firstBytes[static_cast<unsigned char>(stringToTest[0])]) {
+      return false;
+   }
+   if (stringToTest.compare(0, requiredPrefix.length(), requiredPrefix) != 0 ||
+       stringToTest.compare(length - requiredSuffix.length(), requiredSuffix.length(),
+                            requiredSuffix) != 0) {
+      return false;
+   }
+   // Find each literal after the previous one, between the prefix and suffix
+   size_t position = requiredPrefix.length();
+   size_t end = length - requiredSuffix.length();
+   for (const auto& literal : requiredLiterals) {
+      if (!findLiteral(stringToTest, literal, position, end)) {
+         return false;
+      }
+   }
+   return true;
+}
+
+/*******************************************************************************
+ * Is Trivial
+ * This public method determines if the prefilter lets every input through,
+ * in which case checking it is wasted work.
+ * @return              true if every input string may match
+ */
+bool Prefilter::isTrivial() const {
+   return acceptsEmpty && firstBytes.all() && requiredPrefix.empty() &&
+          requiredSuffix.empty() && requiredLiterals.empty();
+}
+
+/*******************************************************************************
+ * Get Memory Usage
+ * This public method returns the number of bytes used by this prefilter: the
+ * size of the object itself plus every buffer it owns on the heap. Strings
+ * short enough to be stored inside the string object own no buffer.
+ * @return              the number of bytes used
+ */
+size_t Prefilter::getMemoryUsage() const {
+   size_t memoryUsage = sizeof(Prefilter) + requiredLiterals.capacity() * sizeof(std::string) +
+                        getStringMemoryUsage(requiredPrefix) +
+                        getStringMemoryUsage(requiredSuffix);
+   for (const auto& literal : requiredLiterals) {
+      memoryUsage += getStringMemoryUsage(literal);
+   }
+   return memoryUsage;
+}
+
+/*******************************************************************************
+ * Getters
+ * These public methods return the facts the prefilter checks.
+ */
+size_t Prefilter::getMinimumLength() const {
+   return minimumLength;
+}
+
+const std::string& Prefilter::getRequiredPrefix() const {
+   return requiredPrefix;
+}
+
+const std::string& Prefilter::getRequiredSuffix() const {
+   return requiredSuffix;
+}
+
+const std::vector<std::string>& Prefilter::getRequiredLiterals() const {
+   return requiredLiterals;
+}
+
+/*******************************************************************************
+ * Add Required Literal
+ * A private helper method to record a literal found on the dominator chain.
+ * A literal that starts at the start node is a prefix, and one that ends at
+ * the sink node is a suffix. A literal that is both spells out every
+ * recognized string.
+ * @param literal       the literal bytes
+ * @param isAtStart     whether the literal starts at the start node
+ * @param isAtEnd       whether the literal ends at the sink node
+ */
+void Prefilter::addRequiredLiteral(const std::string& literal, bool isAtStart,
+                                   bool isAtEnd) {
+   if (literal.empty()) {
+      return;
+   }
+   if (isAtStart) {
+      requiredPrefix = literal;
+   }
+   if (isAtEnd) {
+      requiredSuffix = literal;
+   }
+   if (!isAtStart && !isAtEnd) {
+      requiredLiterals.push_back(literal);
+   }
+}
+
+/*******************************************************************************
+ * Build Prefilter Graph
+ * A private helper method to copy an FSM into a densely indexed graph with an
+ * extra sink node, and to mark the nodes that are reachable from the start
+ * node and can reach a goal node.
+ * @param finiteStateMachine
+ *                      the FSM to copy
+ * @param graph         a reference to the graph to fill in
+ */
+void Prefilter::buildPrefilterGraph(const FiniteStateMachine& finiteStateMachine,
+                                    PrefilterGraph& graph) {
+   MapNodeToStateIndex nodeIndices;
+   int nodeCount = 0;
+   graph.startNode = getStateIndex(nodeIndices, nodeCount, finiteStateMachine.startNode);
+   for (int node : finiteStateMachine.nodes) {
+      getStateIndex(nodeIndices, nodeCount, node);
+   }
+   for (int node : finiteStateMachine.goalNodes) {
+      getStateIndex(nodeIndices, nodeCount, node);
+   }
+   for (Transition transition : finiteStateMachine.transitions) {
+      transition.source = getStateIndex(nodeIndices, nodeCount, transition.source);
+      transition.destination = getStateIndex(nodeIndices, nodeCount, transition.destination);
+      graph.edges.push_back(transition);
+   }
+   graph.sinkNode = nodeCount++;
+   bucketTransitions(graph.edges, nodeCount, true, graph.outgoingOffsets, graph.outgoingEdges);
+   bucketTransitions(graph.edges, nodeCount, false, graph.incomingOffsets, graph.incomingEdges);
+   graph.isGoal.assign(nodeCount, false);
+   for (int node : finiteStateMachine.goalNodes) {
+      graph.isGoal[nodeIndices.at(node)] = true;
+   }
+   // Mark the nodes reachable from the start node
+   std::vector<bool> isReachable(nodeCount, false);
+   std::vector<int> pendingNodes(1, graph.startNode);
+   isReachable[graph.startNode] = true;
+   while (!pendingNodes.empty()) {
+      int node = pendingNodes.back();
+      pendingNodes.pop_back();
+      for (int i = graph.outgoingOffsets[node]; i < graph.outgoingOffsets[node + 1]; i++) {
+         int edge = graph.outgoingEdges[i];
+         int destination = graph.edges[edge].destination;
+         if (!isReachable[destination]) {
+            isReachable[destination] = true;
+            pendingNodes.push_back(destination);
+         }
+      }
+   }
+   // Keep the reachable nodes that can reach a reachable goal node
+   graph.isLive.assign(nodeCount, false);
+   for (int node = 0; node < graph.sinkNode; node++) {
+      if (graph.isGoal[node] && isReachable[node]) {
+         graph.isLive[node] = true;
+         pendingNodes.push_back(node);
+      }
+   }
+   while (!pendingNodes.empty()) {
+      int node = pendingNodes.back();
+      pendingNodes.pop_back();
+      for (int i = graph.incomingOffsets[node]; i < graph.incomingOffsets[node + 1]; i++) {
+         int edge = graph.incomingEdges[i];
+         int source = graph.edges[edge].source;
+         if (isReachable[source] && !graph.isLive[source]) {
+            graph.isLive[source] = true;
+            pendingNodes.push_back(source);
+         }
+      }
+   }
+   graph.isLive[graph.sinkNode] = graph.isLive[graph.startNode];
+}
+
+/*******************************************************************************
+ * Extract First Bytes
+ * A private helper method to find the bytes that leave the epsilon closure of
+ * the start node on an accepting path, and whether that closure contains a
+ * goal node.
+ * @param graph         the graph of the FSM
+ */
+void Prefilter::extractFirstBytes(const PrefilterGraph& graph) {
+   std::vector<bool> isInClosure(graph.isLive.size(), false);
+   std::vector<int> pendingNodes(1, graph.startNode);
+   isInClosure[graph.startNode] = true;
+   while (!pendingNodes.empty()) {
+      int node = pendingNodes.back();
+      pendingNodes.pop_back();
+      acceptsEmpty = acceptsEmpty || graph.isGoal[node];
+      for (int i = graph.outgoingOffsets[node]; i < graph.outgoingOffsets[node + 1]; i++) {
+         int edge = graph.outgoingEdges[i];
+         const Transition& transition = graph.edges[edge];
+         if (!graph.isLive[transition.destination]) {
+            continue;
+         }
+         if (transition.transitionChar == FiniteStateMachine::EPSILON) {
+            if (!isInClosure[transition.destination]) {
+               isInClosure[transition.destination] = true;
+               pendingNodes.push_back(transition.destination);
+            }
+            continue;
+         }
+         int lastByte = std::min(transition.getLastTransitionChar(), 255);
+         for (int byte = std::max(transition.transitionChar, 0); byte <= lastByte; byte++) {
+            firstBytes.set(byte);
+         }
+      }
+   }
+}
+
+/*******************************************************************************
+ * Extract Minimum Length
+ * A private helper method to find the length of the shortest recognized
+ * string with a breadth first search, where epsilon transitions are free.
+ * @param graph         the graph of the FSM
+ */
+void Prefilter::extractMinimumLength(const PrefilterGraph& graph) {
+   std::vector<size_t> distances(graph.isLive.size(), static_cast<size_t>(-1));
+   std::deque<int> pendingNodes(1, graph.startNode);
+   distances[graph.startNode] = 0;
+   while (!pendingNodes.empty()) {
+      int node = pendingNodes.front();
+      pendingNodes.pop_front();
+      if (graph.isGoal[node]) {
+         // The first goal node taken from the queue is the closest one
+         minimumLength = distances[node];
+         return;
+      }
+      for (int i = graph.outgoingOffsets[node]; i < graph.outgoingOffsets[node + 1]; i++) {
+         int edge = graph.outgoingEdges[i];
+         const Transition& transition = graph.edges[edge];
+         bool isEpsilon = transition.transitionChar == FiniteStateMachine::EPSILON;
+         size_t distance = distances[node] + (isEpsilon ? 0 : 1);
+         if (!graph.isLive[transition.destination] ||
+             distance >= distances[transition.destination]) {
+            continue;
+         }
+         distances[transition.destination] = distance;
+         if (isEpsilon) {
+            pendingNodes.push_front(transition.destination);
+         } else {
+            pendingNodes.push_back(transition.destination);
+         }
+      }
+   }
+}
+
+/*******************************************************************************
+ * Extract Required Literals
+ * A private helper method to walk the dominator chain of the sink node,
+ * joining the bytes of consecutive forced steps into literals.
+ * @param graph         the graph of the FSM
+ */
+void Prefilter::extractRequiredLiterals(const PrefilterGraph& graph) {
+   std::vector<int> chain = getSinkDominatorChain(graph);
+   std::string literal;
+   bool isAtStart = true;
+   for (size_t i = 0; i + 1 < chain.size(); i++) {
+      int step = getLiteralStep(graph, chain[i], chain[i + 1]);
+      if (step == LITERAL_EPSILON_STEP) {
+         continue;
+      }
+      if (step == LITERAL_BREAK) {
+         addRequiredLiteral(literal, isAtStart, false);
+         literal.clear();
+         isAtStart = false;
+      } else {
+         literal += static_cast<char>(step);
+      }
+   }
+   addRequiredLiteral(literal, isAtStart, true);
+}
+
+/*******************************************************************************
+ * Find Literal
+ * A private helper method to find the first occurrence of a literal in part of
+ * an input string, using memchr to skip to candidates for its first byte.
+ * @param inputStr      the string to search
+ * @param literal       the non-empty literal to find
+ * @param position      a reference to the search start, moved past the match
+ * @param end           the end of the part of the string to search
+ * @return              true if the literal was found
+ */
+bool Prefilter::findLiteral(const std::string& stringToSearch, const std::string& literal,
+                            size_t& position, size_t end) const {
+   if (end < position + literal.length()) {
+      return false;
+   }
+   const char* data = stringToSearch.data();
+   const char* candidate = data + position;
+   const char* lastCandidate = data + end - literal.length();
+   while (candidate <= lastCandidate) {
+      candidate = static_cast<const char*>(
+         std::memchr(candidate, literal[0], lastCandidate - candidate + 1));
+      if (candidate == nullptr) {
+         return false;
+      }
+      if (std::memcmp(candidate + 1, literal.data() + 1, literal.length() - 1) == 0) {
+         position = candidate - data + literal.length();
+         return true;
+      }
+      candidate++;
+   }
+   return false;
+}
+
+/*******************************************************************************
+ * Get Literal Step
+ * A private helper method to classify the step between two consecutive nodes
+ * of the dominator chain. The step is forced when every live transition
+ * leaving the node goes to the next node, and the node is not a goal node
+ * unless the next node is the sink.
+ * @param graph         the graph of the FSM
+ * @param node          a node of the dominator chain
+ * @param nextNode      the node after it on the chain
+ * @return              the byte every accepting path reads between them,
+ *                      LITERAL_EPSILON_STEP if they read nothing, or
+ *                      LITERAL_BREAK otherwise
+ */
+int Prefilter::getLiteralStep(const PrefilterGraph& graph, int node, int nextNode) {
+   bool hasEpsilon = false;
+   int byte = LITERAL_BREAK;
+   for (int i = graph.outgoingOffsets[node]; i < graph.outgoingOffsets[node + 1]; i++) {
+      int edge = graph.outgoingEdges[i];
+      const Transition& transition = graph.edges[edge];
+      if (!graph.isLive[transition.destination]) {
+         continue;
+      }
+      if (transition.destination != nextNode) {
+         return LITERAL_BREAK;
+      }
+      if (transition.transitionChar == FiniteStateMachine::EPSILON) {
+         hasEpsilon = true;
+      } else if (transition.transitionChar < 0 || transition.transitionChar > 255 ||
+                 transition.getLastTransitionChar() != transition.transitionChar ||
+                 (byte != LITERAL_BREAK && byte != transition.transitionChar)) {
+         return LITERAL_BREAK;
+      } else {
+         byte = transition.transitionChar;
+      }
+   }
+   if (graph.isGoal[node]) {
+      // A goal node leads to the sink, which can only be the next node
+      return nextNode == graph.sinkNode ? LITERAL_EPSILON_STEP : LITERAL_BREAK;
+   }
+   if (hasEpsilon) {
+      return byte == LITERAL_BREAK ? LITERAL_EPSILON_STEP : LITERAL_BREAK;
+   }
+   return byte;
+}
+
+/*******************************************************************************
+ * Get Sink Dominator Chain
+ * A private helper method to find the nodes that are on every path from the
+ * start node to the sink node, in path order. The immediate dominators are
+ * found with the iterative algorithm of Cooper, Harvey, and Kennedy over the
+ * live nodes.
+ * @param graph         the graph of the FSM
+ * @return              the chain of dominators from the start node to the sink
+ */
+std::vector<int> Prefilter::getSinkDominatorChain(const PrefilterGraph& graph) {
+   int nodeCount = graph.sinkNode + 1;
+   std::vector<int> liveGoalNodes;
+   for (int node = 0; node < graph.sinkNode; node++) {
+      if (graph.isGoal[node] && graph.isLive[node]) {
+         liveGoalNodes.push_back(node);
+      }
+   }
+   // Number the nodes in post order with an explicit depth first search,
+   // where the successor after the last edge of a goal node is the sink
+   std::vector<int> postOrder;
+   std::vector<int> postOrderNumbers(nodeCount, -1);
+   std::vector<bool> isVisited(nodeCount, false);
+   std::vector<std::pair<int, int> > pendingNodes(1, std::make_pair(graph.startNode, 0));
+   isVisited[graph.startNode] = true;
+   while (!pendingNodes.empty()) {
+      int node = pendingNodes.back().first;
+      int nextEdge = graph.outgoingOffsets[node] + pendingNodes.back().second++;
+      int successor = -1;
+      if (nextEdge < graph.outgoingOffsets[node + 1]) {
+         successor = graph.edges[graph.outgoingEdges[nextEdge]].destination;
+      } else if (nextEdge == graph.outgoingOffsets[node + 1] && graph.isGoal[node]) {
+         successor = graph.sinkNode;
+      } else {
+         postOrderNumbers[node] = static_cast<int>(postOrder.size());
+         postOrder.push_back(node);
+         pendingNodes.pop_back();
+         continue;
+      }
+      if (graph.isLive[successor] && !isVisited[successor]) {
+         isVisited[successor] = true;
+         pendingNodes.push_back(std::make_pair(successor, 0));
+      }
+   }
+   // Refine the immediate dominators in reverse post order until stable
+   std::vector<int> dominators(nodeCount, -1);
+   dominators[graph.startNode] = graph.startNode;
+   bool isChanged = true;
+   while (isChanged) {
+      isChanged = false;
+      for (int i = static_cast<int>(postOrder.size()) - 1; i >= 0; i--) {
+         int node = postOrder[i];
+         if (node == graph.startNode) {
+            continue;
+         }
+         int dominator = -1;
+         int predecessorCount = node == graph.sinkNode
+                                ? static_cast<int>(liveGoalNodes.size())
+                                : graph.incomingOffsets[node + 1] - graph.incomingOffsets[node];
+         for (int j = 0; j < predecessorCount; j++) {
+            int predecessor = node == graph.sinkNode
+                              ? liveGoalNodes[j]
+                              : graph.edges[graph.incomingEdges[graph.incomingOffsets[node] + j]].source;
+            // Predecessors not yet reached, or not live, are skipped
+            if (dominators[predecessor] == -1) {
+               continue;
+            }
+            if (dominator == -1) {
+               dominator = predecessor;
+               continue;
+            }
+            int other = predecessor;
+            while (dominator != other) {
+               while (postOrderNumbers[dominator] < postOrderNumbers[other]) {
+                  dominator = dominators[dominator];
+               }
+               while (postOrderNumbers[other] < postOrderNumbers[dominator]) {
+                  other = dominators[other];
+               }
+            }
+         }
+         if (dominators[node] != dominator) {
+            dominators[node] = dominator;
+            isChanged = true;
+         }
+      }
+   }
+   std::vector<int> chain(1, graph.sinkNode);
+   while (chain.back() != graph.startNode) {
+      chain.push_back(dominators[chain.back()]);
+   }
+   std::reverse(chain.begin(), chain.end());
+   return chain;
+}
+
+/*******************************************************************************
+ * Get String Memory Usage
+ * A private helper method to find the size of the buffer a string owns on the
+ * heap, which is zero when its characters are stored inside the string.
+ * @param literal       a string
+ * @return              the number of bytes owned on the heap
+ */
+size_t Prefilter::getStringMemoryUsage(const std::string& literal) const {
+   const char* characters = literal.data();
+   const char* object = reinterpret_cast<const char*>(&literal);
+   if (characters >= object && characters < object + sizeof(std::string)) {
+      return 0;
+   }
+   return literal.capacity() + 1;
+}
+
+#endif
@@ -0,0 +1,85 @@
+/*******************************************************************************
+ *  @author             Karl Jansen (kmjansen@uw.edu)
+ *  @version            1.2, 03/16/2015
+ *
+ *  Compilation:        N/A
+ *  Execution:          N/A
+ *  Dependencies:       FiniteStateMachine.cpp; indexStates.cpp;
+ *
+ *  Description:
+ *  The Prefilter class represents facts that every string recognized by a
+ *  Finite State Machine must satisfy: its minimum length, its possible first
+ *  bytes, and the literal byte strings it must start with, end with, and
+ *  contain in order.
+ *
+ *  Functionality:
+ *  This class allows cheap rejection checks to be performed on an input string
+ *  before it is run through an automaton.
+ *
+*******************************************************************************/
+
+#ifndef PREFILTER_H
+#define PREFILTER_H
+
+#include "FiniteStateMachine.cpp"
+#include "indexStates.cpp"
+#include <bitset>
+#include <string>
+#include <vector>
+
+// A densely indexed copy of a FiniteStateMachine used by the analysis, with
+// one extra sink node that every goal node leads to
+struct PrefilterGraph {
+   std::vector<Transition> edges;               // transitions by dense index
+   // edge indices by source and by destination, where node i owns
+   // outgoingEdges[outgoingOffsets[i], outgoingOffsets[i + 1]) and likewise
+   std::vector<int> outgoingOffsets;
+   std::vector<int> outgoingEdges;
+   std::vector<int> incomingOffsets;
+   std::vector<int> incomingEdges;
+   std::vector<bool> isGoal;                    // goal flag by node
+   std::vector<bool> isLive;                    // on some accepting path
+   int startNode;
+   int sinkNode;
+};
+
+class Prefilter {
+   public:
+      Prefilter();                              // default constructor
+      Prefilter(const FiniteStateMachine&);     // overloaded constructor
+
+      bool mayMatch(const std::string&) const;  // may match method
+      bool isTrivial() const;                   // is trivial method
+      size_t getMemoryUsage() const;            // get memory usage method
+      size_t getMinimumLength() const;
+      const std::string& getRequiredPrefix() const;
+      const std::string& getRequiredSuffix() const;
+      const std::vector<std::string>& getRequiredLiterals() const;
+
+   private:
+      // bytes that a non-empty recognized string may start with
+      std::bitset<256> firstBytes;
+      // whether the empty string may be recognized
+      bool acceptsEmpty;
+      // length of the shortest recognized string
+      size_t minimumLength;
+      // literals every recognized string starts with, ends with, and
+      // contains between them in this order
+      std::string requiredPrefix;
+      std::string requiredSuffix;
+      std::vector<std::string> requiredLiterals;
+
+      // helper methods
+      void addRequiredLiteral(const std::string&, bool, bool);
+      void buildPrefilterGraph(const FiniteStateMachine&, PrefilterGraph&);
+      void extractFirstBytes(const PrefilterGraph&);
+      void extractMinimumLength(const PrefilterGraph&);
+      void extractRequiredLiterals(const PrefilterGraph&);
+      bool findLiteral(const std::string&, const std::string&, size_t&, size_t) const;
+      int getLiteralStep(const PrefilterGraph&, int, int);
+      std::vector<int> getSinkDominatorChain(const PrefilterGraph&);
+      size_t getStringMemoryUsage(const std::string&) const;
+
+};
+
+#endif
@@ -0,0 +1,359 @@
+/*******************************************************************************
+ *  @author             Karl Jansen (kmjansen@uw.edu)
+ *  @version            1.2, 03/16/2015
+ *
+ *  Compilation:        N/A
+ *  Execution:          N/A
+ *  Dependencies:       NONE;
+ *
+ *  Purpose:
+ *  This is the implementation of the ScanningService class.
+ *
+ *  Functionality:
+ *  Submitted input strings wait in a bounded queue. A submit blocks while the
+ *  queue is full, which pushes back on the threads producing the inputs, and a
+ *  trySubmit returns false instead. Each worker thread takes up to a batch of
+ *  requests per lock of the queue, recognizes them with the shared automaton,
+ *  and delivers each result on the worker thread. A worker keeps its own
+ *  scratch for CompiledNfaEpsilon, so recognition does not allocate. The
+ *  latencies of every request are added to lock-free log scale histograms,
+ *  whose percentiles are accurate to within a quarter of a power of two.
+ *
+ *  Assumptions:
+ *  The compiled automaton outlives the service. Callbacks are short, since
+ *  they run on a worker thread, and must not submit to a full queue of the
+ *  same service, or shut it down. An exception thrown by a callback is caught
+ *  and counted, and the worker goes on to the next request.
+ *
+*******************************************************************************/
+
+#include "ScanningService.h"
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+
+/*******************************************************************************
+ * Overloaded Constructor
+ * This is public, and starts a scanning service that recognizes inputs with a
+ * compiled DFA.
+ * @param compiledDfa   the compiled DFA to share between the workers
+ * @param workerCount   the number of worker threads
+ * @param queueCapacity the number of requests that can wait in the queue
+ * @param batchSize     the largest number of requests a worker takes at once
+ */
+ScanningService::ScanningService(const CompiledDfa& compiledDfa, int workerCount,
+                                 size_t queueCapacity, size_t batchSize) {
+   dfa = &compiledDfa;
+   nfaEpsilon = nullptr;
+   startWorkers(workerCount, queueCapacity, batchSize);
+}
+
+/*******************************************************************************
+ * Overloaded Constructor
+ * This is public, and starts a scanning service that recognizes inputs with a
+ * compiled NFA-epsilon.
+ * @param compiledNfaEpsilon
+ *                      the compiled NFA-epsilon to share between the workers
+ * @param workerCount   the number of worker threads
+ * @param queueCapacity the number of requests that can wait in the queue
+ * @param batchSize     the largest number of requests a worker takes at once
+ */
+ScanningService::ScanningService(const CompiledNfaEpsilon& compiledNfaEpsilon,
+                                 int workerCount, size_t queueCapacity, size_t batchSize) {
+   dfa = nullptr;
+   nfaEpsilon = &compiledNfaEpsilon;
+   startWorkers(workerCount, queueCapacity, batchSize);
+}
+
+/*******************************************************************************
+ * Destructor
+ * This is public, and shuts the service down, finishing every queued request.
+ */
+ScanningService::~ScanningService() {
+   shutdown();
+}
+
+/*******************************************************************************
+ * Submit
+ * This public method queues an input string, waiting while the queue is full.
+ * @param inputStr      the string to recognize
+ * @param callback      called on a worker thread with the result
+ * @return              true if the request was queued
+ *                      false if the service is shut down
+ */
+bool ScanningService::submit(std::string stringToTest, ScanCallback callback) {
+   return enqueueRequest(stringToTest, callback, true);
+}
+
+/*******************************************************************************
+ * Try Submit
+ * This public method queues an input string if there is room in the queue.
+ * @param inputStr      the string to recognize
+ * @param callback      called on a worker thread with the result
+ * @return              true if the request was queued
+ *                      false if the queue is full or the service is shut down
+ */
+bool ScanningService::trySubmit(std::string stringToTest, ScanCallback callback) {
+   return enqueueRequest(stringToTest, callback, false);
+}
+
+/*******************************************************************************
+ * Submit
+ * This public method queues an input string, waiting while the queue is full,
+ * and returns a future for the result that can be waited on, polled, or
+ * adapted to the awaitable type of an event loop.
+ * @param inputStr      the string to recognize
+ * @return              a future for the result, holding a std::runtime_error
+ *                      if the service is shut down
+ */
+std::future<bool> ScanningService::submit(std::string stringToTest) {
+   std::shared_ptr<std::promise<bool> > promise = std::make_shared<std::promise<bool> >();
+   std::future<bool> result = promise->get_future();
+   ScanCallback callback = [promise](bool isRecognized) {
+      promise->set_value(isRecognized);
+   };
+   if (!enqueueRequest(stringToTest, callback, true)) {
+      promise->set_exception(std::make_exception_ptr(
+         std::runtime_error("ScanningService: the service is shut down")));
+   }
+   return result;
+}
+
+/*******************************************************************************
+ * Shutdown
+ * This public method stops accepting requests, lets the workers finish every
+ * queued request, and waits for them to exit. It can be called from several
+ * threads at once, and every call returns once the workers have exited.
+ * Calling it again does nothing. A worker cannot wait for itself, so calling
+ * it from a callback throws std::logic_error.
+ */
+void ScanningService::shutdown() {
+   if (std::find(workerIds.cbegin(), workerIds.cend(), std::this_thread::get_id()) !=
+       workerIds.cend()) {
+      throw std::logic_error("ScanningService: shutdown called from a worker thread");
+   }
+   {
+      std::lock_guard<std::mutex> lock(queueMutex);
+      isShuttingDown = true;
+   }
+   queueNotEmpty.notify_all();
+   queueNotFull.notify_all();
+   std::call_once(joinFlag, &ScanningService::joinWorkers, this);
+}
+
+/*******************************************************************************
+ * Getters
+ * These public methods return the statistics of the completed requests,
+ * including how many of their callbacks threw. The latencies are in
+ * microseconds, and are zero before any request completes.
+ */
+uint64_t ScanningService::getCompletedCount() const {
+   return completedCount.load();
+}
+
+uint64_t ScanningService::getFailedCallbackCount() const {
+   return failedCallbackCount.load();
+}
+
+LatencyPercentiles ScanningService::getMatchLatency() const {
+   return getPercentiles(matchLatency);
+}
+
+LatencyPercentiles ScanningService::getQueueLatency() const {
+   return getPercentiles(queueLatency);
+}
+
+/*******************************************************************************
+ * Default Constructor
+ * This is private, and cannot be accessed by a client using this class.
+ */
+ScanningService::ScanningService() {
+   // Empty
+}
+
+/*******************************************************************************
+ * Enqueue Request
+ * A private helper method to move an input string and its callback into the
+ * queue, and wake a worker.
+ * @param inputStr      a reference to the string to recognize, moved from
+ * @param callback      a reference to the callback, moved from
+ * @param isBlocking    whether to wait while the queue is full
+ * @return              true if the request was queued
+ */
+bool ScanningService::enqueueRequest(std::string& stringToTest, ScanCallback& callback,
+                                     bool isBlocking) {
+   std::unique_lock<std::mutex> lock(queueMutex);
+   if (isBlocking) {
+      queueNotFull.wait(lock, [this]() {
+         return isShuttingDown || requestQueue.size() < queueCapacity;
+      });
+   }
+   if (isShuttingDown || requestQueue.size() >= queueCapacity) {
+      return false;
+   }
+   ScanRequest request;
+   request.input.swap(stringToTest);
+   request.callback.swap(callback);
+   request.submitTime = ScanClock::now();
+   requestQueue.push_back(std::move(request));
+   lock.unlock();
+   queueNotEmpty.notify_one();
+   return true;
+}
+
+/*******************************************************************************
+ * Get Percentiles
+ * A private helper method to find the percentiles of a latency histogram,
+ * reporting the upper bound of the bucket each percentile falls in.
+ * @param histogram     the histogram to read
+ * @return              the percentiles in microseconds
+ */
+LatencyPercentiles ScanningService::getPercentiles(const LatencyHistogram& histogram) const {
+   uint64_t counts[LatencyHistogram::BUCKET_COUNT];
+   uint64_t totalCount = 0;
+   for (int bucket = 0; bucket < LatencyHistogram::BUCKET_COUNT; bucket++) {
+      counts[bucket] = histogram.counts[bucket].load(std::memory_order_relaxed);
+      totalCount += counts[bucket];
+   }
+   const double fractions[] = { 0.5, 0.9, 0.99, 0.999 };
+   double values[4] = { 0, 0, 0, 0 };
+   for (int i = 0; i < 4 && totalCount > 0; i++) {
+      uint64_t rank = static_cast<uint64_t>(fractions[i] * (totalCount - 1)) + 1;
+      uint64_t seenCount = 0;
+      int bucket = 0;
+      while (seenCount + counts[bucket] < rank) {
+         seenCount += counts[bucket++];
+      }
+      // Bucket 4 * (b - 1) + s holds [4 + s, 5 + s) << (b - 2) for b >= 2
+      double upperBound = bucket < 4 ? bucket + 1
+                          : static_cast<double>(5 + bucket % 4) * (1ULL << (bucket / 4 - 1));
+      values[i] = upperBound / 1e3;
+   }
+   LatencyPercentiles percentiles;
+   percentiles.p50 = values[0];
+   percentiles.p90 = values[1];
+   percentiles.p99 = values[2];
+   percentiles.p999 = values[3];
+   percentiles.max = histogram.maxNanoseconds.load(std::memory_order_relaxed) / 1e3;
+   return percentiles;
+}
+
+/*******************************************************************************
+ * Join Workers
+ * A private helper method to wait for every worker thread to exit. It is
+ * called once, by the first shutdown.
+ */
+void ScanningService::joinWorkers() {
+   for (auto& worker : workers) {
+      worker.join();
+   }
+}
+
+/*******************************************************************************
+ * Record Latency
+ * A private helper method to add a latency to a histogram.
+ * @param histogram     a reference to the histogram to update
+ * @param latency       the latency to add
+ */
+void ScanningService::recordLatency(LatencyHistogram& histogram, ScanClock::duration latency) {
+   uint64_t nanoseconds = static_cast<uint64_t>(std::max<int64_t>(
+      0, std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count()));
+   int bucket = static_cast<int>(nanoseconds);
+   if (nanoseconds >= 4) {
+      int highestBit = 63;
+      while ((nanoseconds >> highestBit) == 0) {
+         highestBit--;
+      }
+      bucket = 4 * (highestBit - 1) + static_cast<int>((nanoseconds >> (highestBit - 2)) & 3);
+   }
+   histogram.counts[bucket].fetch_add(1, std::memory_order_relaxed);
+   uint64_t maxNanoseconds = histogram.maxNanoseconds.load(std::memory_order_relaxed);
+   while (nanoseconds > maxNanoseconds &&
+          !histogram.maxNanoseconds.compare_exchange_weak(maxNanoseconds, nanoseconds,
+                                                          std::memory_order_relaxed)) {
+      // maxNanoseconds now holds the latest maximum, so try again
+   }
+}
+
+/*******************************************************************************
+ * Run Worker
+ * A private helper method run by each worker thread. It takes batches of
+ * requests from the queue until the service shuts down and the queue is
+ * empty.
+ */
+void ScanningService::runWorker() {
+   NfaScratch scratch;
+   std::vector<ScanRequest> batch;
+   while (true) {
+      {
+         std::unique_lock<std::mutex> lock(queueMutex);
+         queueNotEmpty.wait(lock, [this]() {
+            return isShuttingDown || !requestQueue.empty();
+         });
+         if (requestQueue.empty()) {
+            return;
+         }
+         while (!requestQueue.empty() && batch.size() < batchSize) {
+            batch.push_back(std::move(requestQueue.front()));
+            requestQueue.pop_front();
+         }
+      }
+      queueNotFull.notify_all();
+      for (auto& request : batch) {
+         ScanClock::time_point startTime = ScanClock::now();
+         recordLatency(queueLatency, startTime - request.submitTime);
+         bool isRecognized = dfa != nullptr ? dfa->isRecognized(request.input)
+                                            : nfaEpsilon->isRecognized(request.input, scratch);
+         recordLatency(matchLatency, ScanClock::now() - startTime);
+         completedCount.fetch_add(1);
+         try {
+            request.callback(isRecognized);
+         } catch (...) {
+            failedCallbackCount.fetch_add(1);
+         }
+      }
+      batch.clear();
+   }
+}
+
+/*******************************************************************************
+ * Start Workers
+ * A private helper method to set up the queue and statistics, and start the
+ * worker threads. If a thread cannot be started, the ones that were are
+ * shut down before the error is rethrown.
+ * @param workerCount   the number of worker threads
+ * @param queueCapacity the number of requests that can wait in the queue
+ * @param batchSize     the largest number of requests a worker takes at once
+ */
+void ScanningService::startWorkers(int workerCount, size_t newQueueCapacity,
+                                   size_t newBatchSize) {
+   if (workerCount < 1 || newQueueCapacity < 1 || newBatchSize < 1) {
+      throw std::invalid_argument(
+         "ScanningService: worker count, queue capacity, and batch size must be positive");
+   }
+   queueCapacity = newQueueCapacity;
+   batchSize = newBatchSize;
+   isShuttingDown = false;
+   completedCount.store(0);
+   failedCallbackCount.store(0);
+   LatencyHistogram* const histograms[] = { &queueLatency, &matchLatency };
+   for (LatencyHistogram* histogram : histograms) {
+      for (int bucket = 0; bucket < LatencyHistogram::BUCKET_COUNT; bucket++) {
+         histogram->counts[bucket].store(0);
+      }
+      histogram->maxNanoseconds.store(0);
+   }
+   workers.reserve(workerCount);
+   workerIds.reserve(workerCount);
+   try {
+      for (int i = 0; i < workerCount; i++) {
+         workers.emplace_back(&ScanningService::runWorker, this);
+         workerIds.push_back(workers.back().get_id());
+      }
+   } catch (...) {
+      // The destructor does not run for a constructor that throws, so the
+      // workers already started are stopped and joined here
+      shutdown();
+      throw;
+   }
+}
@@ -0,0 +1,116 @@
+/*******************************************************************************
+ *  @author             Karl Jansen (kmjansen@uw.edu)
+ *  @version            1.2, 03/16/2015
+ *
+ *  Compilation:        N/A
+ *  Execution:          N/A
+ *  Dependencies:       CompiledDfa.cpp; CompiledNfaEpsilon.cpp;
+ *
+ *  Description:
+ *  The ScanningService class represents a fixed pool of worker threads that
+ *  recognize input strings with one compiled automaton.
+ *
+ *  Functionality:
+ *  This class allows input strings to be submitted from many threads at once,
+ *  with the result delivered to a callback or a future, and reports how long
+ *  requests waited in the queue and how long they took to match.
+ *
+*******************************************************************************/
+
+#ifndef SCANNINGSERVICE_H
+#define SCANNINGSERVICE_H
+
+#include "CompiledDfa.h"
+#include "CompiledNfaEpsilon.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+typedef std::chrono::steady_clock ScanClock;
+typedef std::function<void(bool)> ScanCallback;
+
+// An input string waiting in the queue, and where to deliver its result
+struct ScanRequest {
+   std::string input;                           // the string to recognize
+   ScanCallback callback;                       // called with the result
+   ScanClock::time_point submitTime;            // when it was queued
+};
+
+// Latency percentiles of the requests completed so far, in microseconds
+struct LatencyPercentiles {
+   double p50;
+   double p90;
+   double p99;
+   double p999;
+   double max;
+};
+
+// A histogram of latencies with four buckets per power of two nanoseconds,
+// which workers update without taking a lock
+struct LatencyHistogram {
+   static const int BUCKET_COUNT = 256;
+   std::atomic<uint64_t> counts[BUCKET_COUNT];
+   std::atomic<uint64_t> maxNanoseconds;
+};
+
+class ScanningService {
+   public:
+      ScanningService(const CompiledDfa&, int, size_t, size_t);
+      ScanningService(const CompiledNfaEpsilon&, int, size_t, size_t);
+      ~ScanningService();                       // destructor
+
+      bool submit(std::string, ScanCallback);   // blocking submit method
+      bool trySubmit(std::string, ScanCallback);  // non-blocking submit method
+      std::future<bool> submit(std::string);    // submit for a future method
+      void shutdown();                          // shutdown method
+      uint64_t getCompletedCount() const;
+      uint64_t getFailedCallbackCount() const;
+      LatencyPercentiles getMatchLatency() const;
+      LatencyPercentiles getQueueLatency() const;
+
+   private:
+      ScanningService();                        // default constructor
+      ScanningService(const ScanningService&);  // not copyable
+      ScanningService& operator=(const ScanningService&);
+
+      // the automaton to recognize with, exactly one of which is set
+      const CompiledDfa* dfa;
+      const CompiledNfaEpsilon* nfaEpsilon;
+      // the bounded queue of requests, guarded by queueMutex
+      std::deque<ScanRequest> requestQueue;
+      size_t queueCapacity;
+      size_t batchSize;
+      bool isShuttingDown;
+      std::mutex queueMutex;
+      std::condition_variable queueNotEmpty;
+      std::condition_variable queueNotFull;
+      // the worker threads, their IDs, which do not change once they start,
+      // and whether they have been joined
+      std::vector<std::thread> workers;
+      std::vector<std::thread::id> workerIds;
+      std::once_flag joinFlag;
+      // statistics of the completed requests
+      std::atomic<uint64_t> completedCount;
+      std::atomic<uint64_t> failedCallbackCount;
+      LatencyHistogram queueLatency;
+      LatencyHistogram matchLatency;
+
+      // helper methods
+      bool enqueueRequest(std::string&, ScanCallback&, bool);
+      void joinWorkers();
+      LatencyPercentiles getPercentiles(const LatencyHistogram&) const;
+      void recordLatency(LatencyHistogram&, ScanClock::duration);
+      void runWorker();
+      void startWorkers(int, size_t, size_t);
+
+};
+
+#endif
@@ -13,27 +13,46 @@
  *  Functionality:
  *  Provides a publicly accessible data structure.
  *
+ *  Assumptions:
+ *  A transition character is a non-negative integer symbol. Byte-level
+ *  machines use the values 0-255, so every byte (including NUL) can be
+ *  matched. Wider machines may use Unicode code points or arbitrary integer
+ *  tokens. Negative values are reserved for out-of-band symbols such as
+ *  FiniteStateMachine::EPSILON.
+ *  A Transition is labeled with the single symbol transitionChar unless
+ *  lastTransitionChar is set, in which case it is labeled with every symbol in
+ *  the inclusive range [transitionChar, lastTransitionChar].
+ *
 *******************************************************************************/
 
 #ifndef TRANSITION_H
 #define TRANSITION_H
 
-#include <functional>
-
 struct Transition {
+    static const int SINGLE_CHAR = -2;          // marks a single symbol label
+
     int source;                                 // id of source node
-    char transitionChar;                        // transition character
+    int transitionChar;                         // (first) transition symbol
     int destination;                            // id of destination node
-};
+    int lastTransitionChar;                     // last symbol of a range label
+
+    // a transition from node 0 to node 0 on the single symbol 0
+    Transition()
+       : source(0), transitionChar(0), destination(0), lastTransitionChar(SINGLE_CHAR) {
+    }
 
-// Define the pair representing the source and transitionChar for use in a map
-typedef std::pair<int, char> TransitionPair;
+    // a transition on a single symbol, or on a range of symbols if the last
+    // symbol is given, so {source, symbol, destination} still initializes one
+    Transition(int source, int transitionChar, int destination,
+               int lastTransitionChar = SINGLE_CHAR)
+       : source(source), transitionChar(transitionChar), destination(destination),
+         lastTransitionChar(lastTransitionChar) {
+    }
 
-// Define the hash function for a TransitionPair
-struct hashTransitionPair {
-   size_t operator()(const TransitionPair& transitionPair) const {
-      return std::hash<int>()(transitionPair.first) ^ std::hash<char>()(transitionPair.second);
-   }
+    // the last symbol of the label, equal to transitionChar for one symbol
+    int getLastTransitionChar() const {
+       return lastTransitionChar < transitionChar ? transitionChar : lastTransitionChar;
+    }
 };
 
 #endif
@@ -0,0 +1,584 @@
+/*******************************************************************************
+ *  @author             Karl Jansen (kmjansen@uw.edu)
+ *  @version            1.2, 03/16/2015
+ *
+ *  Compilation:        $> g++ benchmark.cpp -o benchmark -std=c++11 -O2 -pthread
+ *  Execution:          $> benchmark
+ *  Dependencies:       CompiledDfa.cpp; CompiledNfaEpsilon.cpp; CompiledLazyDfa.cpp;
+ *                      CompiledAutomaton.cpp;
+ *                      convertNfaEpsilonToDfa.cpp; lowerCodePointsToUtf8.cpp;
+ *                      convertRegexToNfaEpsilon.cpp; removeEpsilonTransitions.cpp;
+ *                      combineDfas.cpp; Prefilter.cpp; ScanningService.cpp;
+ *
+ *  Description:
+ *  This program measures the performance of the FiniteStateMachine tools.
+ *
+ *  Functionality:
+ *  Generates reproducible workloads, times each stage of the pipeline, and
+ *  prints the results as one line per measurement.
+ *
+ *  Assumptions:
+ *  NONE
+ *
+*******************************************************************************/
+
+#include "CompiledDfa.cpp"
+#include "CompiledNfaEpsilon.cpp"
+#include "CompiledLazyDfa.cpp"
+#include "CompiledAutomaton.cpp"
+#include "convertNfaEpsilonToDfa.cpp"
+#include "lowerCodePointsToUtf8.cpp"
+#include "convertRegexToNfaEpsilon.cpp"
+#include "removeEpsilonTransitions.cpp"
+#include "combineDfas.cpp"
+#include "Prefilter.cpp"
+#include "ScanningService.cpp"
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <random>
+
+// Definitions
+typedef std::chrono::steady_clock BenchmarkClock;
+
+// Function Prototypes
+void benchmarkConversionBudget(int);
+void benchmarkEpsilonRemoval(int);
+void benchmarkMemoryUsage(int);
+void benchmarkNfaLayout(int);
+void benchmarkPrefilter(int);
+void benchmarkProductAutomata(int);
+void benchmarkRegexCompile(int);
+void benchmarkScanningService(int);
+std::string generateInput(int, const std::string&, std::mt19937&);
+std::vector<std::string> generatePatterns(int, std::mt19937&);
+double getElapsedSeconds(const BenchmarkClock::time_point&);
+size_t getFiniteStateMachineMemoryUsage(const FiniteStateMachine&);
+
+/*******************************************************************************
+ * This is the main driver function of the benchmark. It runs every benchmark
+ * with its default workload size.
+ */
+int main() {
+   benchmarkRegexCompile(5000);
+   benchmarkEpsilonRemoval(20000);
+   benchmarkProductAutomata(200000);
+   benchmarkPrefilter(200000);
+   benchmarkMemoryUsage(5000);
+   benchmarkNfaLayout(100000);
+   benchmarkNfaLayout(1000000);
+   benchmarkScanningService(200000);
+   benchmarkConversionBudget(20000);
+   return 0;
+}
+
+/*******************************************************************************
+ * Benchmark Conversion Budget
+ * Compares building and running an unbounded DFA against a compiled automaton
+ * with a budget of 4096 nodes and 100 ms, for patterns of the form
+ * [a-z]*a[a-z]{n} whose DFAs have 2^(n+1) nodes. Inputs over a-z only reach a
+ * few of the nodes, so a lazy DFA can hold them, while inputs over a and b
+ * reach all of them, so a lazy DFA thrashes and is replaced by the NFA-e. The
+ * unbounded DFA is skipped where its conversion would take minutes.
+ * @param inputCount    the number of inputs of 64 bytes to match
+ */
+void benchmarkConversionBudget(int inputCount) {
+   std::mt19937 generator(2015);
+   const char* const alphabets[] = { "abcdefghijklmnopqrstuvwxyz", "ab" };
+   std::vector<std::string> inputs[2];
+   for (int i = 0; i < 2; i++) {
+      for (int j = 0; j < inputCount; j++) {
+         inputs[i].push_back(generateInput(64, alphabets[i], generator));
+      }
+   }
+   ConversionBudget budget;
+   budget.maxStates = 4096;
+   budget.maxSeconds = 0.1;
+   const char* const kindNames[] = { "DFA     ", "lazy DFA", "NFA-e   " };
+   const int repeatCounts[] = { 10, 14, 20 };
+   std::cout << "conversion budget: " << inputCount << " inputs of 64 bytes" << std::endl;
+   for (int repeatCount : repeatCounts) {
+      std::string pattern = "[a-z]*a[a-z]{" + std::to_string(repeatCount) + "}";
+      FiniteStateMachine fsmNFAe = convertRegexToNfaEpsilon(pattern);
+      std::cout << "  " << pattern << std::endl;
+      for (int i = 0; i < 2; i++) {
+         std::unique_ptr<CompiledDfa> dfa;
+         double dfaBuildSeconds = 0;
+         if (repeatCount <= 14) {
+            BenchmarkClock::time_point startTime = BenchmarkClock::now();
+            dfa.reset(new CompiledDfa(convertNfaEpsilonToDfa(fsmNFAe)));
+            dfaBuildSeconds = getElapsedSeconds(startTime);
+         }
+         BenchmarkClock::time_point startTime = BenchmarkClock::now();
+         CompiledAutomaton automaton(fsmNFAe, budget);
+         double buildSeconds = getElapsedSeconds(startTime);
+         // The first pass fills in the cache of a lazy DFA, and the second reuses it
+         for (int pass = 0; pass < 3; pass++) {
+            if (pass == 0 && !dfa) {
+               continue;
+            }
+            startTime = BenchmarkClock::now();
+            size_t matches = 0;
+            for (const auto& input : inputs[i]) {
+               matches += pass == 0 ? dfa->isRecognized(input) : automaton.isRecognized(input);
+            }
+            double matchSeconds = getElapsedSeconds(startTime);
+            std::cout << "    [" << alphabets[i][0] << "-" << alphabets[i][strlen(alphabets[i]) - 1]
+                      << "] " << (pass == 0 ? "unbounded " : "budgeted  ")
+                      << (pass == 0 ? kindNames[COMPILED_DFA] : kindNames[automaton.getKind()])
+                      << (pass == 2 ? " again " : " build ")
+                      << (pass == 0 ? dfaBuildSeconds : buildSeconds) * 1e3 << " ms, "
+                      << (pass == 0 ? dfa->getMemoryUsage() : automaton.getMemoryUsage())
+                      << " bytes, " << inputCount * 64 / matchSeconds / 1e6 << " MB/s, "
+                      << matches << " matches" << std::endl;
+         }
+      }
+   }
+}
+
+/*******************************************************************************
+ * Benchmark Epsilon Removal
+ * Compares the size and match throughput of regex NFA-epsilons before and
+ * after their epsilon transitions are removed. The inputs are drawn from an
+ * alphabet that keeps the automata alive, so every byte is a full step.
+ * @param inputLength   the length of the input matched by each automaton
+ */
+void benchmarkEpsilonRemoval(int inputLength) {
+   const char* const patterns[] = {
+      "(a*b*c*)*d",
+      "(\\w+\\s*)*\\w*end",
+      "(x?y?z?)*(a|b)*a(a?b?){12}"
+   };
+   const char* const alphabets[] = { "abc", "abc ", "ab" };
+   std::mt19937 generator(2015);
+   std::cout << "epsilon removal: " << inputLength << " byte inputs" << std::endl;
+   for (int i = 0; i < 3; i++) {
+      FiniteStateMachine fsmNFAe = convertRegexToNfaEpsilon(patterns[i]);
+      BenchmarkClock::time_point startTime = BenchmarkClock::now();
+      FiniteStateMachine fsmNFA = removeEpsilonTransitions(fsmNFAe);
+      double removeSeconds = getElapsedSeconds(startTime);
+      CompiledNfaEpsilon nfaEpsilon(fsmNFAe);
+      CompiledNfaEpsilon nfa(fsmNFA);
+      std::string input = generateInput(inputLength, alphabets[i], generator);
+
+      startTime = BenchmarkClock::now();
+      bool nfaEpsilonResult = nfaEpsilon.isRecognized(input);
+      double nfaEpsilonSeconds = getElapsedSeconds(startTime);
+      startTime = BenchmarkClock::now();
+      bool nfaResult = nfa.isRecognized(input);
+      double nfaSeconds = getElapsedSeconds(startTime);
+
+      std::cout << "  " << patterns[i] << std::endl;
+      std::cout << "    NFA-e " << fsmNFAe.nodes.size() << " nodes, "
+                << fsmNFAe.transitions.size() << " transitions, "
+                << inputLength / nfaEpsilonSeconds / 1e6 << " MB/s" << std::endl;
+      std::cout << "    NFA   " << fsmNFA.nodes.size() << " nodes, "
+                << fsmNFA.transitions.size() << " transitions, "
+                << inputLength / nfaSeconds / 1e6 << " MB/s ("
+                << removeSeconds * 1e3 << " ms to build, results "
+                << (nfaEpsilonResult == nfaResult ? "agree" : "DIFFER") << ")" << std::endl;
+   }
+}
+
+/*******************************************************************************
+ * Benchmark Memory Usage
+ * Compiles a batch of generated patterns and reports the bytes used by the
+ * compiled DFAs and NFA-es, next to the bytes of the DFA FiniteStateMachines
+ * they were compiled from.
+ * @param patternCount  the number of patterns to compile
+ */
+void benchmarkMemoryUsage(int patternCount) {
+   std::mt19937 generator(2015);
+   std::vector<std::string> patterns = generatePatterns(patternCount, generator);
+   size_t fsmBytes = 0;
+   size_t dfaBytes = 0;
+   size_t nfaEpsilonBytes = 0;
+   size_t nodeCount = 0;
+   for (const auto& pattern : patterns) {
+      FiniteStateMachine fsmNFAe = convertRegexToNfaEpsilon(pattern);
+      FiniteStateMachine fsmDFA = convertNfaEpsilonToDfa(fsmNFAe);
+      CompiledDfa dfa(fsmDFA);
+      CompiledNfaEpsilon nfaEpsilon(fsmNFAe);
+      fsmBytes += getFiniteStateMachineMemoryUsage(fsmDFA);
+      dfaBytes += dfa.getMemoryUsage();
+      nfaEpsilonBytes += nfaEpsilon.getMemoryUsage();
+      nodeCount += fsmDFA.nodes.size();
+   }
+   std::cout << "memory usage: " << patternCount << " patterns, "
+             << nodeCount / patternCount << " DFA nodes/pattern" << std::endl;
+   std::cout << "  DFA FSM             " << fsmBytes / patternCount << " bytes/pattern" << std::endl;
+   std::cout << "  CompiledDfa         " << dfaBytes / patternCount << " bytes/pattern" << std::endl;
+   std::cout << "  CompiledNfaEpsilon  " << nfaEpsilonBytes / patternCount << " bytes/pattern"
+             << std::endl;
+}
+
+/*******************************************************************************
+ * Benchmark NFA Layout
+ * Measures the construction time and step time of a CompiledNfaEpsilon for a
+ * random NFA-e with about ten transitions per node, labeled with 64 symbols
+ * of which the input uses 16, so the set of current states stays small. The
+ * start node loops on every byte, every hundredth node is a hub with ten times
+ * the transitions, and one in twenty transitions is an epsilon transition.
+ * @param transitionCount
+ *                      the number of transitions in the NFA-e
+ */
+void benchmarkNfaLayout(int transitionCount) {
+   std::mt19937 generator(2015);
+   int nodeCount = transitionCount / 10;
+   FiniteStateMachine fsmNFAe;
+   for (int node = 0; node < nodeCount; node++) {
+      fsmNFAe.nodes.insert(node);
+      if (generator() % 100 == 0) {
+         fsmNFAe.goalNodes.insert(node);
+      }
+   }
+   fsmNFAe.startNode = 0;
+   Transition transition;
+   transition.source = 0;
+   transition.destination = 0;
+   transition.transitionChar = 0;
+   transition.lastTransitionChar = 255;
+   fsmNFAe.transitions.push_back(transition);
+   for (int i = 1; i < transitionCount; i++) {
+      // Every hundredth node is a hub with ten times the transitions
+      transition.source = generator() % nodeCount;
+      if (generator() % 10 == 0) {
+         transition.source -= transition.source % 100;
+      }
+      transition.destination = generator() % nodeCount;
+      transition.lastTransitionChar = Transition::SINGLE_CHAR;
+      int kind = generator() % 20;
+      if (kind == 0) {
+         transition.transitionChar = FiniteStateMachine::EPSILON;
+      } else if (kind == 1) {
+         transition.transitionChar = 'A' + generator() % 64;
+         transition.lastTransitionChar = transition.transitionChar + generator() % 4;
+      } else {
+         transition.transitionChar = 'A' + generator() % 64;
+      }
+      fsmNFAe.transitions.push_back(transition);
+   }
+   std::string input = generateInput(100000, "ABCDEFGHIJKLMNOP", generator);
+
+   BenchmarkClock::time_point startTime = BenchmarkClock::now();
+   CompiledNfaEpsilon nfaEpsilon(fsmNFAe);
+   double constructSeconds = getElapsedSeconds(startTime);
+   startTime = BenchmarkClock::now();
+   bool isRecognized = nfaEpsilon.isRecognized(input);
+   double matchSeconds = getElapsedSeconds(startTime);
+   std::cout << "NFA layout: " << transitionCount << " transitions, " << nodeCount << " nodes"
+             << std::endl;
+   std::cout << "  construction        " << constructSeconds * 1e3 << " ms, "
+             << transitionCount / constructSeconds / 1e6 << " M transitions/s, "
+             << nfaEpsilon.getMemoryUsage() / 1024 << " KiB" << std::endl;
+   std::cout << "  step                " << matchSeconds / input.length() * 1e9 << " ns/byte ("
+             << (isRecognized ? "recognized" : "not recognized") << ")" << std::endl;
+}
+
+/*******************************************************************************
+ * Benchmark Prefilter
+ * Compares matching request lines against a DFA with no prefilter, with the
+ * prefilter extracted from the DFA, and with the prefilter extracted from the
+ * NFA-e. About 2% of the inputs are recognized, and most of the rejects share
+ * the prefix of the pattern so that the literals have to be searched for.
+ * @param inputCount    the number of inputs to evaluate
+ */
+void benchmarkPrefilter(int inputCount) {
+   FiniteStateMachine fsmNFAe = convertRegexToNfaEpsilon("GET /(.*/)?admin/.*\\.php");
+   FiniteStateMachine fsmDFA = convertNfaEpsilonToDfa(fsmNFAe);
+   CompiledDfa unfilteredDfa(fsmDFA);
+   CompiledDfa dfa(fsmDFA);
+   CompiledDfa prefilteredDfa(fsmDFA);
+   unfilteredDfa.setPrefilterEnabled(false);
+   BenchmarkClock::time_point startTime = BenchmarkClock::now();
+   prefilteredDfa.setPrefilter(Prefilter(fsmNFAe));
+   double extractSeconds = getElapsedSeconds(startTime);
+
+   std::mt19937 generator(2015);
+   std::vector<std::string> inputs;
+   size_t totalBytes = 0;
+   for (int i = 0; i < inputCount; i++) {
+      const char* const methods[] = { "GET /", "GET /", "GET /", "POST /", "HEAD /" };
+      std::string input = methods[generator() % 5];
+      input += generateInput(20 + generator() % 100, "abcdefghijklmnopqrstuvwxyz/._-", generator);
+      if (generator() % 50 == 0) {
+         input += "/admin/x.php";
+      }
+      totalBytes += input.length();
+      inputs.push_back(input);
+   }
+
+   std::cout << "prefilter: " << inputCount << " request lines" << std::endl;
+   CompiledDfa* const dfas[] = { &unfilteredDfa, &dfa, &prefilteredDfa };
+   const char* const labels[] = {
+      "  no prefilter        ", "  DFA prefilter       ", "  NFA-e prefilter     "
+   };
+   for (int i = 0; i < 3; i++) {
+      startTime = BenchmarkClock::now();
+      size_t matches = 0;
+      for (const auto& input : inputs) {
+         if (dfas[i]->isRecognized(input)) {
+            matches++;
+         }
+      }
+      double matchSeconds = getElapsedSeconds(startTime);
+      std::cout << labels[i] << totalBytes / matchSeconds / 1e6 << " MB/s, " << matches
+                << " matches";
+      if (i == 2) {
+         std::cout << " (" << extractSeconds * 1e3 << " ms to extract)";
+      }
+      std::cout << std::endl;
+   }
+}
+
+/*******************************************************************************
+ * Benchmark Product Automata
+ * Compares evaluating the policy "matches A and C but not B" with one pass per
+ * DFA against one pass over the minimized product DFA.
+ * @param inputCount    the number of inputs to evaluate
+ */
+void benchmarkProductAutomata(int inputCount) {
+   FiniteStateMachine fsmA = convertNfaEpsilonToDfa(convertRegexToNfaEpsilon("/[a-z0-9/._-]*"));
+   FiniteStateMachine fsmB = convertNfaEpsilonToDfa(convertRegexToNfaEpsilon(".*(\\.\\.|//).*"));
+   FiniteStateMachine fsmC = convertNfaEpsilonToDfa(convertRegexToNfaEpsilon(".*\\.(html|css|js)"));
+   BenchmarkClock::time_point startTime = BenchmarkClock::now();
+   FiniteStateMachine fsmPolicy = minimizeDfa(differenceOfDfas(intersectionOfDfas(fsmA, fsmC), fsmB));
+   double buildSeconds = getElapsedSeconds(startTime);
+   CompiledDfa dfaA(fsmA);
+   CompiledDfa dfaB(fsmB);
+   CompiledDfa dfaC(fsmC);
+   CompiledDfa policyDfa(fsmPolicy);
+
+   std::mt19937 generator(2015);
+   std::vector<std::string> inputs;
+   size_t totalBytes = 0;
+   for (int i = 0; i < inputCount; i++) {
+      std::string input = "/" + generateInput(8 + generator() % 40, "abcxyz019/._-", generator);
+      const char* const extensions[] = { ".html", ".css", ".js", ".png" };
+      input += extensions[generator() % 4];
+      totalBytes += input.length();
+      inputs.push_back(input);
+   }
+
+   startTime = BenchmarkClock::now();
+   size_t multiPassMatches = 0;
+   for (const auto& input : inputs) {
+      if (dfaA.isRecognized(input) && dfaC.isRecognized(input) && !dfaB.isRecognized(input)) {
+         multiPassMatches++;
+      }
+   }
+   double multiPassSeconds = getElapsedSeconds(startTime);
+   startTime = BenchmarkClock::now();
+   size_t onePassMatches = 0;
+   for (const auto& input : inputs) {
+      if (policyDfa.isRecognized(input)) {
+         onePassMatches++;
+      }
+   }
+   double onePassSeconds = getElapsedSeconds(startTime);
+
+   std::cout << "product automata: A & C & !B over " << inputCount << " inputs" << std::endl;
+   std::cout << "  multi-pass          " << fsmA.nodes.size() + fsmB.nodes.size() + fsmC.nodes.size()
+             << " nodes, " << totalBytes / multiPassSeconds / 1e6 << " MB/s, "
+             << multiPassMatches << " matches" << std::endl;
+   std::cout << "  one-pass product    " << fsmPolicy.nodes.size() << " nodes, "
+             << totalBytes / onePassSeconds / 1e6 << " MB/s, " << onePassMatches
+             << " matches (" << buildSeconds * 1e3 << " ms to build)" << std::endl;
+}
+
+/*******************************************************************************
+ * Benchmark Regex Compile
+ * Measures the compile throughput of a batch of generated patterns through
+ * each stage of the pipeline: regex to NFA-e, NFA-e to DFA, and DFA to
+ * CompiledDfa.
+ * @param patternCount  the number of patterns to compile
+ */
+void benchmarkRegexCompile(int patternCount) {
+   std::mt19937 generator(2015);
+   std::vector<std::string> patterns = generatePatterns(patternCount, generator);
+   std::vector<FiniteStateMachine> nfaEpsilons;
+   std::vector<FiniteStateMachine> dfas;
+   size_t nfaTransitionCount = 0;
+   size_t dfaTransitionCount = 0;
+
+   BenchmarkClock::time_point startTime = BenchmarkClock::now();
+   for (const auto& pattern : patterns) {
+      nfaEpsilons.push_back(convertRegexToNfaEpsilon(pattern));
+      nfaTransitionCount += nfaEpsilons.back().transitions.size();
+   }
+   double parseSeconds = getElapsedSeconds(startTime);
+
+   startTime = BenchmarkClock::now();
+   for (const auto& nfaEpsilon : nfaEpsilons) {
+      dfas.push_back(convertNfaEpsilonToDfa(nfaEpsilon));
+      dfaTransitionCount += dfas.back().transitions.size();
+   }
+   double convertSeconds = getElapsedSeconds(startTime);
+
+   startTime = BenchmarkClock::now();
+   size_t recognizedCount = 0;
+   for (auto& dfa : dfas) {
+      CompiledDfa compiledDfa(dfa);
+      recognizedCount += compiledDfa.isRecognized("") ? 1 : 0;
+   }
+   double compileSeconds = getElapsedSeconds(startTime);
+
+   double totalSeconds = parseSeconds + convertSeconds + compileSeconds;
+   std::cout << "regex compile: " << patternCount << " patterns" << std::endl;
+   std::cout << "  regex -> NFA-e      " << parseSeconds * 1e3 << " ms, "
+             << patternCount / parseSeconds << " patterns/s, "
+             << nfaTransitionCount / patternCount << " transitions/pattern" << std::endl;
+   std::cout << "  NFA-e -> DFA        " << convertSeconds * 1e3 << " ms, "
+             << patternCount / convertSeconds << " patterns/s, "
+             << dfaTransitionCount / patternCount << " transitions/pattern" << std::endl;
+   std::cout << "  DFA -> CompiledDfa  " << compileSeconds * 1e3 << " ms, "
+             << patternCount / compileSeconds << " patterns/s" << std::endl;
+   std::cout << "  total               " << totalSeconds * 1e3 << " ms, "
+             << patternCount / totalSeconds << " patterns/s ("
+             << recognizedCount << " accept the empty string)" << std::endl;
+}
+
+/*******************************************************************************
+ * Generate Input
+ * Builds a random input string from the characters of an alphabet.
+ * @param inputLength   the length of the input
+ * @param alphabet      the characters to draw from
+ * @param generator     a reference to the random number generator
+ * @return              the generated input
+ */
+std::string generateInput(int inputLength, const std::string& alphabet,
+                          std::mt19937& generator) {
+   std::string input;
+   for (int i = 0; i < inputLength; i++) {
+      input += alphabet[generator() % alphabet.length()];
+   }
+   return input;
+}
+
+/*******************************************************************************
+ * Generate Patterns
+ * Builds rule-like patterns from random literals, character classes,
+ * alternations, and repetitions.
+ * @param patternCount  the number of patterns to generate
+ * @param generator     a reference to the random number generator
+ * @return              the generated patterns
+ */
+std::vector<std::string> generatePatterns(int patternCount, std::mt19937& generator) {
+   const char* const pieces[] = {
+      "[a-z]+", "[0-9]{1,4}", "\\d{2,3}", "(GET|POST|PUT)", "\\w*", "[^/]+",
+      "(\\.[a-z]{2,3})?", "-", "/", "=", "\\s+", "(ab|cd)*", ".", "[A-F0-9]{8}"
+   };
+   const int pieceCount = sizeof(pieces) / sizeof(pieces[0]);
+   std::vector<std::string> patterns;
+   for (int i = 0; i < patternCount; i++) {
+      std::string pattern;
+      int length = 3 + generator() % 6;
+      for (int j = 0; j < length; j++) {
+         if (generator() % 3 == 0) {
+            // A short literal keeps patterns distinct
+            for (int k = 0; k < 3; k++) {
+               pattern += static_cast<char>('a' + generator() % 26);
+            }
+         } else {
+            pattern += pieces[generator() % pieceCount];
+         }
+      }
+      patterns.push_back(pattern);
+   }
+   return patterns;
+}
+
+/*******************************************************************************
+ * Get Elapsed Seconds
+ * Returns the seconds elapsed since a point in time.
+ * @param startTime     the point in time to measure from
+ * @return              the elapsed time in seconds
+ */
+double getElapsedSeconds(const BenchmarkClock::time_point& startTime) {
+   return std::chrono::duration<double>(BenchmarkClock::now() - startTime).count();
+}
+
+/*******************************************************************************
+ * Get Finite State Machine Memory Usage
+ * Returns the bytes used by a FiniteStateMachine, counting a list node as its
+ * transition plus two pointers, and a hash set node as its element plus a
+ * next pointer.
+ * @param finiteStateMachine
+ *                      the FSM to measure
+ * @return              the number of bytes used
+ */
+size_t getFiniteStateMachineMemoryUsage(const FiniteStateMachine& finiteStateMachine) {
+   return sizeof(FiniteStateMachine) +
+          finiteStateMachine.transitions.size() * (sizeof(Transition) + 2 * sizeof(void*)) +
+          (finiteStateMachine.nodes.bucket_count() + finiteStateMachine.goalNodes.bucket_count()) *
+             sizeof(void*) +
+          (finiteStateMachine.nodes.size() + finiteStateMachine.goalNodes.size()) *
+             (sizeof(int) + sizeof(void*));
+}
+
+/*******************************************************************************
+ * Benchmark Scanning Service
+ * Generates load for a scanning service from two producer threads, with 1, 2,
+ * and 4 workers for the DFA and the NFA-e, and reports the throughput and the
+ * latency percentiles. About 2% of the request lines are recognized.
+ * @param inputCount    the number of inputs to submit
+ */
+void benchmarkScanningService(int inputCount) {
+   FiniteStateMachine fsmNFAe = convertRegexToNfaEpsilon("GET /(.*/)?admin/.*\\.php");
+   CompiledNfaEpsilon nfaEpsilon(fsmNFAe);
+   CompiledDfa dfa(convertNfaEpsilonToDfa(fsmNFAe));
+
+   std::mt19937 generator(2015);
+   std::vector<std::string> inputs;
+   size_t totalBytes = 0;
+   for (int i = 0; i < inputCount; i++) {
+      std::string input = "GET /";
+      input += generateInput(20 + generator() % 100, "abcdefghijklmnopqrstuvwxyz/._-", generator);
+      if (generator() % 50 == 0) {
+         input += "/admin/x.php";
+      }
+      totalBytes += input.length();
+      inputs.push_back(input);
+   }
+
+   std::cout << "scanning service: " << inputCount << " request lines from 2 producers, "
+             << std::thread::hardware_concurrency() << " hardware threads" << std::endl;
+   const int producerCount = 2;
+   const int workerCounts[] = { 1, 2, 4 };
+   for (int engine = 0; engine < 2; engine++) {
+      for (int workerCount : workerCounts) {
+         std::atomic<size_t> matches(0);
+         ScanCallback callback = [&matches](bool isRecognized) {
+            if (isRecognized) {
+               matches.fetch_add(1, std::memory_order_relaxed);
+            }
+         };
+         std::unique_ptr<ScanningService> service(
+            engine == 0 ? new ScanningService(dfa, workerCount, 1024, 16)
+                        : new ScanningService(nfaEpsilon, workerCount, 1024, 16));
+         BenchmarkClock::time_point startTime = BenchmarkClock::now();
+         std::vector<std::thread> producers;
+         for (int producer = 0; producer < producerCount; producer++) {
+            producers.push_back(std::thread([&, producer]() {
+               for (size_t i = producer; i < inputs.size(); i += producerCount) {
+                  service->submit(inputs[i], callback);
+               }
+            }));
+         }
+         for (auto& producer : producers) {
+            producer.join();
+         }
+         service->shutdown();
+         double scanSeconds = getElapsedSeconds(startTime);
+         LatencyPercentiles queueLatency = service->getQueueLatency();
+         LatencyPercentiles matchLatency = service->getMatchLatency();
+         std::cout << (engine == 0 ? "  DFA, " : "  NFA-e, ") << workerCount << " workers  "
+                   << inputCount / scanSeconds / 1e3 << " k/s, "
+                   << totalBytes / scanSeconds / 1e6 << " MB/s, " << matches << " matches, "
+                   << "queue p99 " << queueLatency.p99 << " us, match p50 "
+                   << matchLatency.p50 << " us, p99 " << matchLatency.p99 << " us, max "
+                   << matchLatency.max << " us" << std::endl;
+      }
+   }
+}
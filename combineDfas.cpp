@@ -0,0 +1,539 @@
+/*******************************************************************************
+ *  @author             Karl Jansen (kmjansen@uw.edu)
+ *  @version            1.2, 03/16/2015
+ *
+ *  Compilation:        N/A
+ *  Execution:          N/A
+ *  Dependencies:       combineDfas.h;
+ *
+ *  Description:
+ *  This program combines DFA FiniteStateMachines into a single DFA that
+ *  recognizes the intersection, union, or difference of their languages, or
+ *  the complement of one language, and minimizes DFAs.
+ *
+ *  Functionality:
+ *  The binary operations use the product construction. Each node of the result
+ *  is a pair of nodes from the two inputs, and only the pairs reachable from
+ *  the pair of start nodes are built. The ranges leaving a pair are split into
+ *  disjoint ranges, as in convertNfaEpsilonToDfa, and a missing transition is
+ *  treated as a transition to an implicit dead node. Pairs in which a DFA the
+ *  operation depends on is dead are not built at all. Compound
+ *  policies such as "matches A but not B" then take a single pass over the
+ *  input instead of one pass per DFA.
+ *  The complement makes the DFA total over [0, maxSymbol] with an explicit
+ *  dead node before swapping goal and non-goal nodes.
+ *  Minimization drops unreachable and dead nodes, then refines the partition
+ *  of goal and non-goal nodes until no two nodes in a block disagree on the
+ *  block reached by any symbol (Moore's algorithm).
+ *
+ *  Assumptions:
+ *  The FiniteStateMachines passed into the functions are valid DFAs, such as
+ *  the ones returned from convertNfaEpsilonToDfa. The results are valid DFAs
+ *  with nodes numbered from 1.
+ *
+*******************************************************************************/
+
+#include "combineDfas.h"
+#include <algorithm>
+#include <map>
+#include <queue>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Definitions
+typedef std::vector<Transition> TransitionVector;
+typedef std::pair<int, int> ProductState;
+typedef std::map<ProductState, int> MapProductStateToNode;
+typedef std::map<std::vector<int>, int> MapSignatureToBlock;
+
+// The languages a product construction can recognize
+enum ProductOperation { INTERSECTION, UNION, DIFFERENCE };
+
+// A DFA with densely numbered states and the sorted ranges of every state,
+// where the destination of each range is a state index
+struct IndexedDfa {
+   std::unordered_map<int, int> stateIndices;
+   std::vector<TransitionVector> stateRanges;
+   std::vector<bool> goalStates;
+   int startState;
+};
+
+// Data for the product construction
+struct ProductData {
+   IndexedDfa leftDfa;
+   IndexedDfa rightDfa;
+   ProductOperation operation;
+   FiniteStateMachine product;
+   MapProductStateToNode productNodes;
+   std::queue<ProductState> pendingStates;
+   int nodeNumber = 1;
+};
+
+// Function Prototypes
+void addRangeTransition(FiniteStateMachine&, int, int, int, int);
+FiniteStateMachine combineDfas(const FiniteStateMachine&, const FiniteStateMachine&, ProductOperation);
+int getIndexedDfaState(IndexedDfa&, int);
+int getNextIndexedDfaState(const IndexedDfa&, int, int);
+int getProductNode(ProductData&, const ProductState&);
+void indexDfa(const FiniteStateMachine&, IndexedDfa&);
+bool isProductGoal(const ProductData&, const ProductState&);
+void processProductState(ProductData&, const ProductState&);
+
+/*******************************************************************************
+ * Complement DFA
+ * Takes a DFA and builds a DFA that recognizes every string over the symbols
+ * [0, maxSymbol] that the input does not. This process takes O(n + t) time
+ * where n is the number of nodes and t is the number of transitions. A
+ * maxSymbol outside [0, MAX_SYMBOL] throws std::invalid_argument.
+ * @param dfa           a reference to a DFA FiniteStateMachine
+ * @param maxSymbol     the largest symbol of the alphabet, a byte by default
+ * @return              the complement DFA FiniteStateMachine
+ */
+FiniteStateMachine complementDfa(const FiniteStateMachine& dfa, int maxSymbol) {
+   if (maxSymbol < 0 || maxSymbol > FiniteStateMachine::MAX_SYMBOL) {
+      throw std::invalid_argument("complementDfa: maxSymbol " + std::to_string(maxSymbol) +
+                                  " outside [0, MAX_SYMBOL]");
+   }
+   IndexedDfa indexedDfa;
+   indexDfa(dfa, indexedDfa);
+   int stateCount = static_cast<int>(indexedDfa.stateRanges.size());
+   int deadNode = stateCount + 1;
+   bool usesDeadNode = false;
+   FiniteStateMachine complement;
+   complement.startNode = indexedDfa.startState + 1;
+   for (int state = 0; state < stateCount; state++) {
+      complement.nodes.insert(state + 1);
+      if (!indexedDfa.goalStates[state]) {
+         complement.goalNodes.insert(state + 1);
+      }
+      // Send every symbol without a transition to the dead node
+      int nextSymbol = 0;
+      for (const auto& range : indexedDfa.stateRanges[state]) {
+         if (range.transitionChar > maxSymbol) {
+            break;
+         }
+         if (range.transitionChar > nextSymbol) {
+            addRangeTransition(complement, state + 1, nextSymbol, range.transitionChar - 1, deadNode);
+            usesDeadNode = true;
+         }
+         int lastSymbol = std::min(range.getLastTransitionChar(), maxSymbol);
+         addRangeTransition(complement, state + 1, range.transitionChar, lastSymbol,
+                            range.destination + 1);
+         nextSymbol = lastSymbol + 1;
+      }
+      if (nextSymbol <= maxSymbol) {
+         addRangeTransition(complement, state + 1, nextSymbol, maxSymbol, deadNode);
+         usesDeadNode = true;
+      }
+   }
+   if (usesDeadNode) {
+      complement.nodes.insert(deadNode);
+      complement.goalNodes.insert(deadNode);
+      addRangeTransition(complement, deadNode, 0, maxSymbol, deadNode);
+   }
+   return complement;
+}
+
+/*******************************************************************************
+ * Difference of DFAs
+ * Takes two DFAs and builds a DFA that recognizes the strings recognized by
+ * the first DFA and not by the second.
+ * @param leftDfa       a reference to the DFA that must recognize a string
+ * @param rightDfa      a reference to the DFA that must not recognize it
+ * @return              the difference DFA FiniteStateMachine
+ */
+FiniteStateMachine differenceOfDfas(const FiniteStateMachine& leftDfa,
+                                    const FiniteStateMachine& rightDfa) {
+   return combineDfas(leftDfa, rightDfa, DIFFERENCE);
+}
+
+/*******************************************************************************
+ * Intersection of DFAs
+ * Takes two DFAs and builds a DFA that recognizes the strings recognized by
+ * both of them.
+ * @param leftDfa       a reference to a DFA FiniteStateMachine
+ * @param rightDfa      a reference to a DFA FiniteStateMachine
+ * @return              the intersection DFA FiniteStateMachine
+ */
+FiniteStateMachine intersectionOfDfas(const FiniteStateMachine& leftDfa,
+                                      const FiniteStateMachine& rightDfa) {
+   return combineDfas(leftDfa, rightDfa, INTERSECTION);
+}
+
+/*******************************************************************************
+ * Minimize DFA
+ * Takes a DFA and builds the equivalent DFA with the fewest nodes. Nodes that
+ * are unreachable from the start node or cannot reach a goal node are
+ * removed, so missing transitions stand for the dead node. This process takes
+ * O(n * t log t) time where n is the number of nodes and t is the number of
+ * transitions.
+ * @param dfa           a reference to a DFA FiniteStateMachine
+ * @return              the minimal DFA FiniteStateMachine
+ */
+FiniteStateMachine minimizeDfa(const FiniteStateMachine& dfa) {
+   IndexedDfa indexedDfa;
+   indexDfa(dfa, indexedDfa);
+   int stateCount = static_cast<int>(indexedDfa.stateRanges.size());
+   // Find the live states: reachable from the start and able to reach a goal
+   std::vector<bool> isReachable(stateCount, false);
+   std::vector<int> pendingStates(1, indexedDfa.startState);
+   isReachable[indexedDfa.startState] = true;
+   std::vector<std::vector<int> > predecessors(stateCount);
+   while (!pendingStates.empty()) {
+      int state = pendingStates.back();
+      pendingStates.pop_back();
+      for (const auto& range : indexedDfa.stateRanges[state]) {
+         predecessors[range.destination].push_back(state);
+         if (!isReachable[range.destination]) {
+            isReachable[range.destination] = true;
+            pendingStates.push_back(range.destination);
+         }
+      }
+   }
+   std::vector<bool> isLive(stateCount, false);
+   for (int state = 0; state < stateCount; state++) {
+      if (isReachable[state] && indexedDfa.goalStates[state]) {
+         isLive[state] = true;
+         pendingStates.push_back(state);
+      }
+   }
+   while (!pendingStates.empty()) {
+      int state = pendingStates.back();
+      pendingStates.pop_back();
+      for (int predecessor : predecessors[state]) {
+         if (!isLive[predecessor]) {
+            isLive[predecessor] = true;
+            pendingStates.push_back(predecessor);
+         }
+      }
+   }
+   FiniteStateMachine minimalDfa;
+   minimalDfa.startNode = 1;
+   minimalDfa.nodes.insert(1);
+   if (!isLive[indexedDfa.startState]) {
+      return minimalDfa;
+   }
+   // Refine the goal / non-goal partition until it is stable
+   std::vector<int> blocks(stateCount, -1);
+   size_t blockCount = 0;
+   std::vector<std::vector<int> > blockSignatures;
+   for (int state = 0; state < stateCount; state++) {
+      if (isLive[state]) {
+         blocks[state] = indexedDfa.goalStates[state] ? 1 : 0;
+      }
+   }
+   while (true) {
+      MapSignatureToBlock signatureBlocks;
+      std::vector<int> nextBlocks(stateCount, -1);
+      std::vector<std::vector<int> > nextBlockSignatures;
+      for (int state = 0; state < stateCount; state++) {
+         if (!isLive[state]) {
+            continue;
+         }
+         // The signature is the current block followed by the merged ranges
+         // of (first symbol, last symbol, destination block)
+         std::vector<int> signature(1, blocks[state]);
+         for (const auto& range : indexedDfa.stateRanges[state]) {
+            int destinationBlock = blocks[range.destination];
+            if (destinationBlock == -1) {
+               continue;
+            }
+            size_t signatureSize = signature.size();
+            if (signatureSize > 1 && signature[signatureSize - 1] == destinationBlock &&
+                signature[signatureSize - 2] + 1 == range.transitionChar) {
+               signature[signatureSize - 2] = range.getLastTransitionChar();
+               continue;
+            }
+            signature.push_back(range.transitionChar);
+            signature.push_back(range.getLastTransitionChar());
+            signature.push_back(destinationBlock);
+         }
+         std::pair<MapSignatureToBlock::iterator, bool> blockItr =
+            signatureBlocks.insert(std::make_pair(signature, static_cast<int>(signatureBlocks.size())));
+         nextBlocks[state] = blockItr.first->second;
+         if (blockItr.second) {
+            nextBlockSignatures.push_back(signature);
+         }
+      }
+      bool isStable = signatureBlocks.size() == blockCount;
+      if (isStable) {
+         // The signatures name destinations by their previous block, which is
+         // the same partition under different numbers
+         std::vector<int> previousToNextBlock(std::max(blockCount, static_cast<size_t>(2)), -1);
+         for (int state = 0; state < stateCount; state++) {
+            if (isLive[state]) {
+               previousToNextBlock[blocks[state]] = nextBlocks[state];
+            }
+         }
+         for (auto& signature : nextBlockSignatures) {
+            for (size_t i = 3; i < signature.size(); i += 3) {
+               signature[i] = previousToNextBlock[signature[i]];
+            }
+         }
+      }
+      blocks.swap(nextBlocks);
+      blockSignatures.swap(nextBlockSignatures);
+      blockCount = signatureBlocks.size();
+      if (isStable) {
+         break;
+      }
+   }
+   // Build one node per block from the signature of the block
+   minimalDfa.nodes.clear();
+   minimalDfa.startNode = blocks[indexedDfa.startState] + 1;
+   for (size_t block = 0; block < blockCount; block++) {
+      const std::vector<int>& signature = blockSignatures[block];
+      int node = static_cast<int>(block) + 1;
+      minimalDfa.nodes.insert(node);
+      for (size_t i = 1; i + 2 < signature.size(); i += 3) {
+         addRangeTransition(minimalDfa, node, signature[i], signature[i + 1], signature[i + 2] + 1);
+      }
+   }
+   for (int state = 0; state < stateCount; state++) {
+      if (isLive[state] && indexedDfa.goalStates[state]) {
+         minimalDfa.goalNodes.insert(blocks[state] + 1);
+      }
+   }
+   return minimalDfa;
+}
+
+/*******************************************************************************
+ * Union of DFAs
+ * Takes two DFAs and builds a DFA that recognizes the strings recognized by
+ * either of them.
+ * @param leftDfa       a reference to a DFA FiniteStateMachine
+ * @param rightDfa      a reference to a DFA FiniteStateMachine
+ * @return              the union DFA FiniteStateMachine
+ */
+FiniteStateMachine unionOfDfas(const FiniteStateMachine& leftDfa,
+                               const FiniteStateMachine& rightDfa) {
+   return combineDfas(leftDfa, rightDfa, UNION);
+}
+
+/*******************************************************************************
+ * Add Range Transition
+ * A helper method to add a range labeled transition to a FiniteStateMachine.
+ * @param fsm           a reference to a FiniteStateMachine
+ * @param source        the source node
+ * @param firstCharacter
+ *                      the first symbol of the range
+ * @param lastCharacter the last symbol of the range
+ * @param destination   the destination node
+ */
+void addRangeTransition(FiniteStateMachine& fsm, int source, int firstCharacter,
+                        int lastCharacter, int destination) {
+   Transition theTransition;
+   theTransition.source = source;
+   theTransition.transitionChar = firstCharacter;
+   theTransition.lastTransitionChar = lastCharacter;
+   theTransition.destination = destination;
+   fsm.transitions.push_back(theTransition);
+}
+
+/*******************************************************************************
+ * Combine DFAs
+ * A helper method to run the product construction of two DFAs for an
+ * operation. This process takes O(n * m) time in the worst case where n and m
+ * are the number of nodes in the two DFAs, but only reachable pairs are built.
+ * @param leftDfa       a reference to a DFA FiniteStateMachine
+ * @param rightDfa      a reference to a DFA FiniteStateMachine
+ * @param operation     the language operation to build
+ * @return              the product DFA FiniteStateMachine
+ */
+FiniteStateMachine combineDfas(const FiniteStateMachine& leftDfa,
+                               const FiniteStateMachine& rightDfa,
+                               ProductOperation operation) {
+   ProductData productData;
+   productData.operation = operation;
+   indexDfa(leftDfa, productData.leftDfa);
+   indexDfa(rightDfa, productData.rightDfa);
+   ProductState startState(productData.leftDfa.startState, productData.rightDfa.startState);
+   productData.product.startNode = getProductNode(productData, startState);
+   while (!productData.pendingStates.empty()) {
+      ProductState currentState = productData.pendingStates.front();
+      productData.pendingStates.pop();
+      processProductState(productData, currentState);
+   }
+   return productData.product;
+}
+
+/*******************************************************************************
+ * Get Indexed DFA State
+ * A helper method to find the dense state index of a node, assigning the next
+ * free index to a node seen for the first time.
+ * @param indexedDfa    a reference to an IndexedDfa
+ * @param node          a node of the original DFA
+ * @return              the state index of the node
+ */
+int getIndexedDfaState(IndexedDfa& indexedDfa, int node) {
+   std::unordered_map<int, int>::const_iterator indexItr = indexedDfa.stateIndices.find(node);
+   if (indexItr != indexedDfa.stateIndices.cend()) {
+      return indexItr->second;
+   }
+   int stateIndex = static_cast<int>(indexedDfa.stateRanges.size());
+   indexedDfa.stateIndices[node] = stateIndex;
+   indexedDfa.stateRanges.push_back(TransitionVector());
+   indexedDfa.goalStates.push_back(false);
+   return stateIndex;
+}
+
+/*******************************************************************************
+ * Get Next Indexed DFA State
+ * A helper method to find the state reached from a state on a symbol.
+ * @param indexedDfa    a reference to an IndexedDfa
+ * @param state         the current state, or -1 for the dead state
+ * @param symbol        the symbol to follow
+ * @return              the next state, or -1 for the dead state
+ */
+int getNextIndexedDfaState(const IndexedDfa& indexedDfa, int state, int symbol) {
+   if (state == -1) {
+      return -1;
+   }
+   const TransitionVector& ranges = indexedDfa.stateRanges[state];
+   TransitionVector::const_iterator rangeItr =
+      std::upper_bound(ranges.cbegin(), ranges.cend(), symbol,
+                       [](int character, const Transition& range) {
+                          return character < range.transitionChar;
+                       });
+   if (rangeItr != ranges.cbegin() && (--rangeItr)->getLastTransitionChar() >= symbol) {
+      return rangeItr->destination;
+   }
+   return -1;
+}
+
+/*******************************************************************************
+ * Get Product Node
+ * A helper method to find the node of the product for a pair of states. A pair
+ * seen for the first time is mapped to a new node number, marked as a goal
+ * node if the operation accepts there, and added to the pending queue.
+ * @param productData   a reference to the product construction data
+ * @param productState  the pair of states
+ * @return              the node of the product
+ */
+int getProductNode(ProductData& productData, const ProductState& productState) {
+   MapProductStateToNode::const_iterator nodeItr = productData.productNodes.find(productState);
+   if (nodeItr != productData.productNodes.cend()) {
+      return nodeItr->second;
+   }
+   int productNode = productData.nodeNumber++;
+   productData.productNodes[productState] = productNode;
+   productData.product.nodes.insert(productNode);
+   if (isProductGoal(productData, productState)) {
+      productData.product.goalNodes.insert(productNode);
+   }
+   productData.pendingStates.push(productState);
+   return productNode;
+}
+
+/*******************************************************************************
+ * Index DFA
+ * A helper method to number the nodes of a DFA densely and sort the ranges
+ * leaving every node.
+ * @param dfa           a reference to a DFA FiniteStateMachine
+ * @param indexedDfa    a reference to the IndexedDfa to fill
+ */
+void indexDfa(const FiniteStateMachine& dfa, IndexedDfa& indexedDfa) {
+   dfa.checkSymbols();
+   indexedDfa.startState = getIndexedDfaState(indexedDfa, dfa.startNode);
+   for (int node : dfa.nodes) {
+      getIndexedDfaState(indexedDfa, node);
+   }
+   for (int node : dfa.goalNodes) {
+      indexedDfa.goalStates[getIndexedDfaState(indexedDfa, node)] = true;
+   }
+   for (Transition transition : dfa.transitions) {
+      int sourceState = getIndexedDfaState(indexedDfa, transition.source);
+      transition.destination = getIndexedDfaState(indexedDfa, transition.destination);
+      indexedDfa.stateRanges[sourceState].push_back(transition);
+   }
+   for (auto& ranges : indexedDfa.stateRanges) {
+      std::sort(ranges.begin(), ranges.end(),
+                [](const Transition& left, const Transition& right) {
+                   return left.transitionChar < right.transitionChar;
+                });
+   }
+}
+
+/*******************************************************************************
+ * Is Product Goal
+ * A helper method to determine if the operation accepts at a pair of states.
+ * @param productData   a reference to the product construction data
+ * @param productState  the pair of states
+ * @return              true if the pair is a goal node of the product
+ */
+bool isProductGoal(const ProductData& productData, const ProductState& productState) {
+   bool isLeftGoal = productState.first != -1 &&
+                     productData.leftDfa.goalStates[productState.first];
+   bool isRightGoal = productState.second != -1 &&
+                      productData.rightDfa.goalStates[productState.second];
+   switch (productData.operation) {
+      case INTERSECTION:
+         return isLeftGoal && isRightGoal;
+      case UNION:
+         return isLeftGoal || isRightGoal;
+      case DIFFERENCE:
+         return isLeftGoal && !isRightGoal;
+   }
+   return false;
+}
+
+/*******************************************************************************
+ * Process Product State
+ * A helper method to split the ranges leaving a pair of states into disjoint
+ * ranges and add a product transition for each one. Pairs that can never
+ * accept for the operation are skipped, and consecutive ranges that lead to
+ * the same node are merged into a single transition.
+ * @param productData   a reference to the product construction data
+ * @param productState  the pair of states
+ */
+void processProductState(ProductData& productData, const ProductState& productState) {
+   int sourceNode = productData.productNodes.at(productState);
+   std::vector<int> boundaries;
+   if (productState.first != -1) {
+      for (const auto& range : productData.leftDfa.stateRanges[productState.first]) {
+         boundaries.push_back(range.transitionChar);
+         boundaries.push_back(range.getLastTransitionChar() + 1);
+      }
+   }
+   if (productState.second != -1) {
+      for (const auto& range : productData.rightDfa.stateRanges[productState.second]) {
+         boundaries.push_back(range.transitionChar);
+         boundaries.push_back(range.getLastTransitionChar() + 1);
+      }
+   }
+   std::sort(boundaries.begin(), boundaries.end());
+   boundaries.erase(std::unique(boundaries.begin(), boundaries.end()), boundaries.end());
+   int pendingFirst = 0;
+   int pendingLast = 0;
+   int pendingDestination = -1;
+   for (size_t i = 0; i + 1 < boundaries.size(); i++) {
+      int firstCharacter = boundaries[i];
+      int lastCharacter = boundaries[i + 1] - 1;
+      ProductState nextState(
+         getNextIndexedDfaState(productData.leftDfa, productState.first, firstCharacter),
+         getNextIndexedDfaState(productData.rightDfa, productState.second, firstCharacter));
+      // Only a union can still accept once the left DFA is dead, and only a
+      // union or difference once the right DFA is dead
+      if ((nextState.first == -1 && (productData.operation != UNION || nextState.second == -1)) ||
+          (nextState.second == -1 && productData.operation == INTERSECTION)) {
+         continue;
+      }
+      int destinationNode = getProductNode(productData, nextState);
+      if (destinationNode == pendingDestination && pendingLast + 1 == firstCharacter) {
+         pendingLast = lastCharacter;
+         continue;
+      }
+      if (pendingDestination != -1) {
+         addRangeTransition(productData.product, sourceNode, pendingFirst, pendingLast,
+                            pendingDestination);
+      }
+      pendingFirst = firstCharacter;
+      pendingLast = lastCharacter;
+      pendingDestination = destinationNode;
+   }
+   if (pendingDestination != -1) {
+      addRangeTransition(productData.product, sourceNode, pendingFirst, pendingLast,
+                         pendingDestination);
+   }
+}
@@ -0,0 +1,33 @@
+/*******************************************************************************
+ *  @author             Karl Jansen (kmjansen@uw.edu)
+ *  @version            1.2, 03/16/2015
+ *
+ *  Compilation:        N/A
+ *  Execution:          N/A
+ *  Dependencies:       FiniteStateMachine.cpp;
+ *
+ *  Description:
+ *  This file declares the functions used to combine DFA FiniteStateMachines
+ *  with product constructions, and to minimize the result.
+ *
+ *  Functionality:
+ *  Provides the prototypes for the DFA intersection, union, difference,
+ *  complement, and minimization operations.
+ *
+*******************************************************************************/
+
+#ifndef COMBINEDFAS_H
+#define COMBINEDFAS_H
+
+#include "FiniteStateMachine.cpp"
+
+static const int MAX_BYTE_SYMBOL = 255;         // largest byte-level symbol
+
+// Function Prototypes
+FiniteStateMachine complementDfa(const FiniteStateMachine&, int = MAX_BYTE_SYMBOL);
+FiniteStateMachine differenceOfDfas(const FiniteStateMachine&, const FiniteStateMachine&);
+FiniteStateMachine intersectionOfDfas(const FiniteStateMachine&, const FiniteStateMachine&);
+FiniteStateMachine minimizeDfa(const FiniteStateMachine&);
+FiniteStateMachine unionOfDfas(const FiniteStateMachine&, const FiniteStateMachine&);
+
+#endif
@@ -4,7 +4,7 @@
  *
  *  Compilation:        N/A
  *  Execution:          N/A
- *  Dependencies:       FiniteStateMachine.h;
+ *  Dependencies:       convertNfaEpsilonToDfa.h;
  *
  *  Description:
  *  This program converts a NFA-epsilon FiniteStateMachine into an equivalent
@@ -14,7 +14,16 @@
  *  This function uses an algorithm to convert a formally defined Finite State
  *  Machine that represents a Non-Deterministic Finite Automaton with Epsilon
  *  Transitions into an equivalent Finite State Machine that is a Deterministic
- *  Finite Automaton.
+ *  Finite Automaton. Range labeled transitions are carried through the subset
+ *  construction: the ranges leaving each set of nodes are split into disjoint
+ *  ranges, and adjacent ranges that lead to the same set are merged again, so
+ *  the DFA has one transition per distinct range rather than per symbol.
+ *  A conversion given a ConversionBudget checks it before processing each set
+ *  of nodes, and stops once it builds too many nodes, runs too long, or holds
+ *  too much memory. The memory is estimated from the sets of nodes that have
+ *  been seen or are pending, and the nodes and transitions of the DFA. The
+ *  DFA built so far is returned with the status, and recognizes a subset of
+ *  the language, since the pending sets of nodes have no transitions.
  *
  *  Assumptions:
  *  The FiniteStateMachine passed into the function is a valid NFA-epsilon.
@@ -22,11 +31,15 @@
  *
 *******************************************************************************/
 
-#include "FiniteStateMachine.h"
+#include "convertNfaEpsilonToDfa.h"
+#include <algorithm>
+#include <chrono>
 #include <functional>
 #include <queue>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
+#include <vector>
 
 // Hash Function for Unordered Set of Integers 
 struct hashIntSet {
@@ -43,33 +56,39 @@ struct hashIntSet {
 
 // Definitions
 typedef std::unordered_set<int> UnorderedIntSet;
-typedef std::unordered_set<char> UnorderedCharSet;
+typedef std::vector<Transition> TransitionVector;
+typedef std::unordered_map<int, TransitionVector> MapNodeToTransitions;
 typedef std::unordered_map<UnorderedIntSet, int, hashIntSet> MapStatesToInt;
 typedef std::queue<UnorderedIntSet> QueueIntSets;
+typedef std::chrono::steady_clock ConversionClock;
 
 // Data for the conversion algorithm
 struct ConversionData {
    FiniteStateMachine dfa;
-   FiniteStateMachine nfaEpsilon;
+   const FiniteStateMachine* nfaEpsilon;        // read in place, not copied
+   MapNodeToTransitions epsilonTransitionsBySource;
+   MapNodeToTransitions transitionsBySource;
    MapStatesToInt mapSetToDfaNode;
    int nodeNumber = 1;
    QueueIntSets pendingSetsOfNodes;
    UnorderedIntSet stateSet;
+   ConversionBudget budget;
+   ConversionClock::time_point startTime;
+   ConversionStatus status = CONVERSION_COMPLETE;
+   size_t memoryUsage = 0;
 };
 
 // Function Prototypes
-FiniteStateMachine convertNfaEpsilonToDfa(const FiniteStateMachine&);
-void getEpsilonClosure(UnorderedIntSet&, const std::list<Transition>&);
-void getGoalNodesForDFA();
-void getNextSetOfNodes(UnorderedIntSet&, const UnorderedIntSet&, char);
-void getNextTransitionCharacters(UnorderedCharSet&, const UnorderedIntSet&);
-void getStartNodeForDFA();
-void processCurrentSetOfNodes();
-void processNextSetOfNodes(const UnorderedIntSet&, const UnorderedIntSet&, char);
-void processTransitionCharacters(const UnorderedCharSet&, const UnorderedIntSet&);
-
-// Global Variables
-ConversionData conversionData;
+void addDfaTransition(ConversionData&, int, int, int, int);
+ConversionStatus getBudgetStatus(const ConversionData&);
+int getDfaNodeForSetOfNodes(ConversionData&, const UnorderedIntSet&);
+void getEpsilonClosure(const ConversionData&, UnorderedIntSet&);
+void getNextTransitionRanges(const ConversionData&, TransitionVector&, const UnorderedIntSet&);
+size_t getSetOfNodesMemoryUsage(const UnorderedIntSet&);
+void getStartNodeForDFA(ConversionData&);
+void indexTransitions(ConversionData&);
+void processCurrentSetOfNodes(ConversionData&);
+void processTransitionRanges(ConversionData&, TransitionVector&, const UnorderedIntSet&);
 
 /*******************************************************************************
  * Convert NfaEpsilon to Dfa
@@ -80,168 +99,314 @@ ConversionData conversionData;
  * @return              a DFA FiniteStateMachine
  */
 FiniteStateMachine convertNfaEpsilonToDfa(const FiniteStateMachine& inputNfaEpsilon) {
-   conversionData.nfaEpsilon = inputNfaEpsilon;
-   getStartNodeForDFA();
-   while (!conversionData.pendingSetsOfNodes.empty()) {
-      processCurrentSetOfNodes();
-   }
-   getGoalNodesForDFA();
-   return conversionData.dfa;
+   return convertNfaEpsilonToDfa(inputNfaEpsilon, ConversionBudget()).dfa;
 }
 
 /*******************************************************************************
- * Get Epsilon Closure
- * A helper method to add nodes to the current state if an epsilon transition
- * exists.
- * @param states        a reference to a set of states
- * @param transitions   a reference to a list of Transitions
+ * Convert NfaEpsilon to Dfa
+ * Takes an NFA-epsilon and converts it to an equivalent DFA, unless the
+ * conversion exceeds the budget first, in which case it stops and returns the
+ * DFA built so far.
+ * @param inputNfaEpsilon
+ *                      a reference to a NFA-epsilon FiniteStateMachine
+ * @param budget        the limits on the conversion
+ * @return              the DFA, how the conversion ended, and its cost
  */
-void getEpsilonClosure(UnorderedIntSet& states,
-                       const std::list<Transition>& transitions) {
-   int inserts = 0;
-   for (Transition transition : transitions) {
-      if (states.count(transition.source) > 0 &&
-          transition.transitionChar == FiniteStateMachine::EPSILON &&
-          states.count(transition.destination) == 0) {
-         states.insert(transition.destination);
-         inserts++;
+ConversionResult convertNfaEpsilonToDfa(const FiniteStateMachine& inputNfaEpsilon,
+                                        const ConversionBudget& budget) {
+   inputNfaEpsilon.checkSymbols();
+   ConversionData conversionData;
+   conversionData.nfaEpsilon = &inputNfaEpsilon;
+   conversionData.budget = budget;
+   conversionData.startTime = ConversionClock::now();
+   indexTransitions(conversionData);
+   getStartNodeForDFA(conversionData);
+   while (!conversionData.pendingSetsOfNodes.empty() &&
+          conversionData.status == CONVERSION_COMPLETE) {
+      conversionData.status = getBudgetStatus(conversionData);
+      if (conversionData.status == CONVERSION_COMPLETE) {
+         processCurrentSetOfNodes(conversionData);
       }
    }
-   // If there is a newly reachable epsilon transition
-   // Recursively add more nodes to state set 
-   if (inserts > 0) {
-      getEpsilonClosure(states, transitions);
+   ConversionResult result;
+   result.dfa = std::move(conversionData.dfa);
+   result.status = conversionData.status;
+   result.memoryUsage = conversionData.memoryUsage;
+   result.seconds = std::chrono::duration<double>(ConversionClock::now() -
+                                                  conversionData.startTime).count();
+   return result;
+}
+
+/*******************************************************************************
+ * Add DFA Transition
+ * A helper method to add a range labeled transition to the DFA.
+ * @param conversionData
+ *                      a reference to the conversion data
+ * @param source        the source node in the DFA
+ * @param firstCharacter
+ *                      the first symbol of the range
+ * @param lastCharacter the last symbol of the range
+ * @param destination   the destination node in the DFA
+ */
+void addDfaTransition(ConversionData& conversionData, int source, int firstCharacter,
+                      int lastCharacter, int destination) {
+   Transition theTransition;
+   theTransition.source = source;
+   theTransition.transitionChar = firstCharacter;
+   theTransition.lastTransitionChar = lastCharacter;
+   theTransition.destination = destination;
+   conversionData.dfa.transitions.push_front(theTransition);
+   conversionData.memoryUsage += sizeof(Transition) + 2 * sizeof(void*);
+}
+
+/*******************************************************************************
+ * Get Budget Status
+ * A helper method to check the memory and time of the conversion against its
+ * budget. The number of nodes is checked as each node is added.
+ * @param conversionData
+ *                      a reference to the conversion data
+ * @return              CONVERSION_COMPLETE if the conversion can go on
+ *                      the limit that was exceeded otherwise
+ */
+ConversionStatus getBudgetStatus(const ConversionData& conversionData) {
+   const ConversionBudget& budget = conversionData.budget;
+   if (budget.maxMemoryBytes > 0 && conversionData.memoryUsage > budget.maxMemoryBytes) {
+      return CONVERSION_MEMORY_LIMIT;
+   }
+   if (budget.maxSeconds > 0 &&
+       std::chrono::duration<double>(ConversionClock::now() -
+                                     conversionData.startTime).count() > budget.maxSeconds) {
+      return CONVERSION_TIME_LIMIT;
    }
+   return CONVERSION_COMPLETE;
 }
 
 /*******************************************************************************
- * Get Goal Nodes for DFA
- * A helper method to find the corresponding set of goal nodes from the
- * NFA-epsilon for the DFA.
+ * Get DFA Node for Set of Nodes
+ * A helper method to find the DFA node for a set of NFA-epsilon nodes. A set
+ * seen for the first time is mapped to a new node number, marked as a goal
+ * node if it contains a goal node of the NFA-epsilon, and added to the pending
+ * queue. A new set that would take the DFA over the node budget is not added,
+ * and stops the conversion.
+ * @param conversionData
+ *                      a reference to the conversion data
+ * @param setOfNodes    a reference to an unordered set of integers
+ * @return              the DFA node for the set of nodes, or -1 if there is
+ *                      no room in the budget for a new node
  */
-void getGoalNodesForDFA() {
-   for (int node : conversionData.nfaEpsilon.goalNodes) {
-      for (MapStatesToInt::const_iterator stateItr = conversionData.mapSetToDfaNode.cbegin();
-           stateItr != conversionData.mapSetToDfaNode.cend();
-           ++stateItr) {
-         if ((stateItr->first).count(node) > 0) {
-            int goalNode = conversionData.mapSetToDfaNode.at(stateItr->first);
-            conversionData.dfa.goalNodes.insert(goalNode);
-         }
+int getDfaNodeForSetOfNodes(ConversionData& conversionData, const UnorderedIntSet& setOfNodes) {
+   MapStatesToInt::const_iterator setItr = conversionData.mapSetToDfaNode.find(setOfNodes);
+   if (setItr != conversionData.mapSetToDfaNode.cend()) {
+      return setItr->second;
+   }
+   if (conversionData.budget.maxStates > 0 &&
+       conversionData.dfa.nodes.size() >= conversionData.budget.maxStates) {
+      conversionData.status = CONVERSION_STATE_LIMIT;
+      return -1;
+   }
+   // The set is held as a key of the map and as an entry of the queue
+   conversionData.memoryUsage += 2 * getSetOfNodesMemoryUsage(setOfNodes) +
+                                 sizeof(int) + 4 * sizeof(void*);
+   int dfaNode = conversionData.nodeNumber++;
+   conversionData.mapSetToDfaNode[setOfNodes] = dfaNode;
+   conversionData.dfa.nodes.insert(dfaNode);
+   for (int node : setOfNodes) {
+      if (conversionData.nfaEpsilon->goalNodes.count(node) > 0) {
+         conversionData.dfa.goalNodes.insert(dfaNode);
+         break;
       }
    }
+   conversionData.pendingSetsOfNodes.push(setOfNodes);
+   return dfaNode;
 }
 
 /*******************************************************************************
- * Get Next Set Of Nodes
- * A helper method to find the next set of nodes from the current set of states
- * in the NFA-epsilon based on the provided transition character
- * @param nextSetOfNodes
- *                      a reference to an unordered set of integers
- * @param currentSetOfNodes
- *                      a reference to an unordered set of integers
- * @param nextCharacter a char representing the transition character to use
+ * Get Epsilon Closure
+ * A helper method to add nodes to the current state if an epsilon transition
+ * exists.
+ * @param conversionData
+ *                      a reference to the conversion data
+ * @param states        a reference to a set of states
  */
-void getNextSetOfNodes(UnorderedIntSet& nextSetOfNodes,
-                       const UnorderedIntSet& currentSetOfNodes,
-                       char nextCharacter) {
-   for (Transition transition : conversionData.nfaEpsilon.transitions) {
-      if (currentSetOfNodes.count(transition.source) > 0 &&
-          nextCharacter == transition.transitionChar) {
-         nextSetOfNodes.insert(transition.destination);
+void getEpsilonClosure(const ConversionData& conversionData, UnorderedIntSet& states) {
+   std::vector<int> pendingStates(states.cbegin(), states.cend());
+   while (!pendingStates.empty()) {
+      int sourceState = pendingStates.back();
+      pendingStates.pop_back();
+      MapNodeToTransitions::const_iterator epsilonItr =
+         conversionData.epsilonTransitionsBySource.find(sourceState);
+      if (epsilonItr == conversionData.epsilonTransitionsBySource.cend()) {
+         continue;
+      }
+      for (const auto& transition : epsilonItr->second) {
+         // Newly reachable nodes may have epsilon transitions of their own
+         if (states.insert(transition.destination).second) {
+            pendingStates.push_back(transition.destination);
+         }
       }
    }
-   getEpsilonClosure(nextSetOfNodes, conversionData.nfaEpsilon.transitions);
 }
 
 /*******************************************************************************
- * Get Next Transition Characters
- * A helper method to find the possible transition characters for the current
- * set of nodes in the NFA-epsilon.
- * @param nextTransitionChars
- *                      a reference to an unordered set of chars
+ * Get Next Transition Ranges
+ * A helper method to find the non-epsilon transitions leaving the current set
+ * of nodes in the NFA-epsilon.
+ * @param conversionData
+ *                      a reference to the conversion data
+ * @param nextTransitionRanges
+ *                      a reference to a vector of Transitions
  * @param currentSetOfNodes
  *                      a reference to an unordered set of integers
  */
-void getNextTransitionCharacters(UnorderedCharSet& nextTransitionChars,
-                                 const UnorderedIntSet& currentSetOfNodes) {
-   for (Transition transition : conversionData.nfaEpsilon.transitions) {
-      if (currentSetOfNodes.count(transition.source) > 0 &&
-          transition.transitionChar != FiniteStateMachine::EPSILON) {
-         nextTransitionChars.insert(transition.transitionChar);
+void getNextTransitionRanges(const ConversionData& conversionData,
+                             TransitionVector& nextTransitionRanges,
+                             const UnorderedIntSet& currentSetOfNodes) {
+   for (int node : currentSetOfNodes) {
+      MapNodeToTransitions::const_iterator transitionItr =
+         conversionData.transitionsBySource.find(node);
+      if (transitionItr != conversionData.transitionsBySource.cend()) {
+         nextTransitionRanges.insert(nextTransitionRanges.end(),
+                                     transitionItr->second.cbegin(),
+                                     transitionItr->second.cend());
       }
    }
 }
 
+/*******************************************************************************
+ * Get Set of Nodes Memory Usage
+ * A helper method to estimate the bytes held by a set of nodes: the set
+ * itself, a node per element, and the bucket array.
+ * @param setOfNodes    a reference to an unordered set of integers
+ * @return              the estimated number of bytes
+ */
+size_t getSetOfNodesMemoryUsage(const UnorderedIntSet& setOfNodes) {
+   return sizeof(UnorderedIntSet) + setOfNodes.size() * (sizeof(void*) + sizeof(int)) +
+          setOfNodes.bucket_count() * sizeof(void*);
+}
+
 /*******************************************************************************
  * Get Start Node for DFA
  * A helper method to determine the corresponding start node from the
  * NFA-epsilon for the DFA.
+ * @param conversionData
+ *                      a reference to the conversion data
  */
-void getStartNodeForDFA() {
-   conversionData.stateSet.insert(conversionData.nfaEpsilon.startNode);
-   getEpsilonClosure(conversionData.stateSet, conversionData.nfaEpsilon.transitions);
-   conversionData.pendingSetsOfNodes.push(conversionData.stateSet);
-   conversionData.mapSetToDfaNode[conversionData.stateSet] = conversionData.nodeNumber;
-   conversionData.dfa.nodes.insert(conversionData.nodeNumber++);
-   conversionData.dfa.startNode = conversionData.mapSetToDfaNode.at(conversionData.stateSet);
+void getStartNodeForDFA(ConversionData& conversionData) {
+   conversionData.stateSet.insert(conversionData.nfaEpsilon->startNode);
+   getEpsilonClosure(conversionData, conversionData.stateSet);
+   conversionData.dfa.startNode = getDfaNodeForSetOfNodes(conversionData,
+                                                          conversionData.stateSet);
+}
+
+/*******************************************************************************
+ * Index Transitions
+ * A helper method to group the transitions of the NFA-epsilon by source node,
+ * so each set of nodes only visits its own outgoing transitions.
+ * @param conversionData
+ *                      a reference to the conversion data
+ */
+void indexTransitions(ConversionData& conversionData) {
+   for (const auto& transition : conversionData.nfaEpsilon->transitions) {
+      if (transition.transitionChar == FiniteStateMachine::EPSILON) {
+         conversionData.epsilonTransitionsBySource[transition.source].push_back(transition);
+      } else {
+         conversionData.transitionsBySource[transition.source].push_back(transition);
+      }
+   }
 }
 
 /*******************************************************************************
  * Process Current Set of Nodes
  * A helper method to get and process the transitions for the next set of nodes
  * on the pending queue.
+ * @param conversionData
+ *                      a reference to the conversion data
  */
-void processCurrentSetOfNodes() {
+void processCurrentSetOfNodes(ConversionData& conversionData) {
    UnorderedIntSet currentSetOfNodes = conversionData.pendingSetsOfNodes.front();
    conversionData.pendingSetsOfNodes.pop();
-   UnorderedCharSet nextTransitionChars;
-   getNextTransitionCharacters(nextTransitionChars, currentSetOfNodes);
-   processTransitionCharacters(nextTransitionChars, currentSetOfNodes);
+   conversionData.memoryUsage -= getSetOfNodesMemoryUsage(currentSetOfNodes);
+   TransitionVector nextTransitionRanges;
+   getNextTransitionRanges(conversionData, nextTransitionRanges, currentSetOfNodes);
+   processTransitionRanges(conversionData, nextTransitionRanges, currentSetOfNodes);
 }
 
 /*******************************************************************************
- * Process Next Set of Nodes
- * A helper method to update the map for the new set of nodes and add a
- * transition to the DFA from the current set of states to the next set of
- * states in the NFA-epsilon.
- * @param nextSetOfNodes
- *                      a reference to an unordered set of integers
+ * Process Transition Ranges
+ * A helper method to split the transition ranges of the current set of nodes
+ * into disjoint ranges, find the next set of nodes for each disjoint range, and
+ * add the corresponding DFA transitions. Consecutive disjoint ranges that lead
+ * to the same DFA node are merged into a single transition.
+ * @param conversionData
+ *                      a reference to the conversion data
+ * @param nextTransitionRanges
+ *                      a reference to a vector of Transitions
  * @param currentSetOfNodes
  *                      a reference to an unordered set of integers
- * @param nextCharacter a char representing the transition character to use
  */
-void processNextSetOfNodes(const UnorderedIntSet& currentSetOfNodes,
-                           const UnorderedIntSet& nextSetOfNodes,
-                           char nextCharacter) {
-   if (conversionData.mapSetToDfaNode.count(nextSetOfNodes) == 0) {
-      // Add next set of nodes to the pending queue and map it to a new node number
-      conversionData.pendingSetsOfNodes.push(nextSetOfNodes);
-      conversionData.mapSetToDfaNode[nextSetOfNodes] = conversionData.nodeNumber;
-      conversionData.dfa.nodes.insert(conversionData.nodeNumber++);
+void processTransitionRanges(ConversionData& conversionData, TransitionVector& nextTransitionRanges,
+                             const UnorderedIntSet& currentSetOfNodes) {
+   if (nextTransitionRanges.empty()) {
+      return;
    }
-   // Add the corresponding DFA transition
-   Transition theTransition;
-   theTransition.source = conversionData.mapSetToDfaNode.at(currentSetOfNodes);
-   theTransition.transitionChar = nextCharacter;
-   theTransition.destination = conversionData.mapSetToDfaNode.at(nextSetOfNodes);
-   conversionData.dfa.transitions.push_front(theTransition);
-}
-
-/*******************************************************************************
- * Process Transition Characters
- * A helper method to manage getting a processing the next set of nodes based
- * on the current set of transition characters.
- * @param nextTransitionChars
- *                      a reference to an unordered set of chars
- * @param currentSetOfNodes
- *                      a reference to an unordered set of integers
- */
-void processTransitionCharacters(const UnorderedCharSet& nextTransitionChars,
-                                 const UnorderedIntSet& currentSetOfNodes) {
-   for (char nextCharacter : nextTransitionChars) {
+   int sourceNode = conversionData.mapSetToDfaNode.at(currentSetOfNodes);
+   // Every range starts a disjoint range at its first symbol and ends one
+   // after its last symbol
+   std::vector<int> boundaries;
+   for (const auto& transition : nextTransitionRanges) {
+      boundaries.push_back(transition.transitionChar);
+      boundaries.push_back(transition.getLastTransitionChar() + 1);
+   }
+   std::sort(boundaries.begin(), boundaries.end());
+   boundaries.erase(std::unique(boundaries.begin(), boundaries.end()), boundaries.end());
+   std::sort(nextTransitionRanges.begin(), nextTransitionRanges.end(),
+             [](const Transition& left, const Transition& right) {
+                return left.transitionChar < right.transitionChar;
+             });
+   // Sweep the disjoint ranges, tracking the transition ranges covering each
+   std::vector<const Transition*> activeRanges;
+   size_t nextRange = 0;
+   int pendingFirst = 0;
+   int pendingLast = 0;
+   int pendingDestination = -1;
+   for (size_t i = 0; i + 1 < boundaries.size(); i++) {
+      int firstCharacter = boundaries[i];
+      int lastCharacter = boundaries[i + 1] - 1;
+      activeRanges.erase(std::remove_if(activeRanges.begin(), activeRanges.end(),
+                                        [firstCharacter](const Transition* range) {
+                                           return range->getLastTransitionChar() < firstCharacter;
+                                        }),
+                         activeRanges.end());
+      while (nextRange < nextTransitionRanges.size() &&
+             nextTransitionRanges[nextRange].transitionChar == firstCharacter) {
+         activeRanges.push_back(&nextTransitionRanges[nextRange++]);
+      }
+      if (activeRanges.empty()) {
+         continue;
+      }
       UnorderedIntSet nextSetOfNodes;
-      getNextSetOfNodes(nextSetOfNodes, currentSetOfNodes, nextCharacter);
-      processNextSetOfNodes(currentSetOfNodes, nextSetOfNodes, nextCharacter);
+      for (const Transition* range : activeRanges) {
+         nextSetOfNodes.insert(range->destination);
+      }
+      getEpsilonClosure(conversionData, nextSetOfNodes);
+      int destinationNode = getDfaNodeForSetOfNodes(conversionData, nextSetOfNodes);
+      if (destinationNode == -1) {
+         continue;
+      }
+      if (destinationNode == pendingDestination && pendingLast + 1 == firstCharacter) {
+         pendingLast = lastCharacter;
+         continue;
+      }
+      if (pendingDestination != -1) {
+         addDfaTransition(conversionData, sourceNode, pendingFirst, pendingLast,
+                          pendingDestination);
+      }
+      pendingFirst = firstCharacter;
+      pendingLast = lastCharacter;
+      pendingDestination = destinationNode;
+   }
+   if (pendingDestination != -1) {
+      addDfaTransition(conversionData, sourceNode, pendingFirst, pendingLast,
+                       pendingDestination);
    }
 }
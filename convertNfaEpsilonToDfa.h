@@ -0,0 +1,51 @@
+/*******************************************************************************
+ *  @author             Karl Jansen (kmjansen@uw.edu)
+ *  @version            1.2, 03/16/2015
+ *
+ *  Compilation:        N/A
+ *  Execution:          N/A
+ *  Dependencies:       FiniteStateMachine.cpp;
+ *
+ *  Description:
+ *  This file declares the functions used to convert a NFA-epsilon
+ *  FiniteStateMachine into an equivalent DFA FiniteStateMachine, and the
+ *  budget that bounds the work of a conversion.
+ *
+ *  Functionality:
+ *  Provides the prototypes for the unbounded conversion and for the
+ *  conversion that stops once it exceeds a budget.
+ *
+*******************************************************************************/
+
+#ifndef CONVERTNFAEPSILONTODFA_H
+#define CONVERTNFAEPSILONTODFA_H
+
+#include "FiniteStateMachine.cpp"
+#include <cstddef>
+
+// Limits on the work of a conversion, where a limit of zero is no limit
+struct ConversionBudget {
+   size_t maxStates = 0;                        // most DFA nodes to build
+   size_t maxMemoryBytes = 0;                   // most bytes the work may hold
+   double maxSeconds = 0;                       // most seconds to run for
+};
+
+// How a conversion ended
+enum ConversionStatus {
+   CONVERSION_COMPLETE, CONVERSION_STATE_LIMIT, CONVERSION_MEMORY_LIMIT, CONVERSION_TIME_LIMIT
+};
+
+// The DFA built by a conversion, which is only equivalent to the NFA-epsilon
+// if the status is CONVERSION_COMPLETE, and the work it took
+struct ConversionResult {
+   FiniteStateMachine dfa;                      // the DFA built so far
+   ConversionStatus status;                     // how the conversion ended
+   size_t memoryUsage;                          // estimated bytes at the end
+   double seconds;                              // time the conversion took
+};
+
+// Function Prototypes
+FiniteStateMachine convertNfaEpsilonToDfa(const FiniteStateMachine&);
+ConversionResult convertNfaEpsilonToDfa(const FiniteStateMachine&, const ConversionBudget&);
+
+#endif
@@ -0,0 +1,821 @@
+/*******************************************************************************
+ *  @author             Karl Jansen (kmjansen@uw.edu)
+ *  @version            1.2, 03/16/2015
+ *
+ *  Compilation:        N/A
+ *  Execution:          N/A
+ *  Dependencies:       convertRegexToNfaEpsilon.h;
+ *
+ *  Description:
+ *  This program compiles a regular expression into an equivalent NFA-epsilon
+ *  FiniteStateMachine over UTF-8 bytes.
+ *
+ *  Functionality:
+ *  The pattern is parsed by recursive descent into a tree of regex nodes, and
+ *  the tree is built into a NFA-epsilon over code points with a compact form
+ *  of Thompson's construction: concatenation shares nodes instead of linking
+ *  fragments with epsilon transitions, and new nodes are only created where a
+ *  fragment needs an entry point of its own. Redundant epsilon transitions are
+ *  then removed, and the result is lowered to UTF-8 bytes.
+ *
+ *  Supported syntax:
+ *  Concatenation, alternation (|), grouping ((...) and (?:...)), Kleene star
+ *  (*), plus (+), optional (?), bounded repetition ({m}, {m,}, {m,n}), the
+ *  wildcard (.) matching any code point except a newline, character classes
+ *  ([...] and [^...]) with ranges, and the escapes \d \D \w \W \s \S \n \r \t
+ *  \f \v \0 \xHH and \x{H...}. Any other escaped punctuation is a literal.
+ *
+ *  Assumptions:
+ *  The pattern is valid UTF-8. A pattern always describes the whole input, so
+ *  the anchors ^ and $ are not supported. An invalid pattern throws
+ *  std::invalid_argument, as does a pattern whose groups, or whose tree of
+ *  regex nodes, nest deeper than MAX_REGEX_NESTING, which bounds the recursion
+ *  of the parser and of the builder, or a pattern that expands to more than
+ *  MAX_REGEX_EXPANDED_SIZE NFA-epsilon nodes and transitions, which bounds
+ *  nested bounded repetitions such as ((a{1000}){1000}){1000}.
+ *
+*******************************************************************************/
+
+#include "convertRegexToNfaEpsilon.h"
+#include <algorithm>
+#include <set>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Definitions
+typedef std::pair<int, int> CodePointRange;
+typedef std::vector<CodePointRange> CodePointRangeVector;
+typedef std::unordered_map<int, std::vector<int> > MapNodeToTransitionIndices;
+
+// A node of the parsed regular expression
+struct RegexNode {
+   enum Kind { EMPTY, CLASS, CONCATENATION, ALTERNATION, REPETITION };
+
+   Kind kind;                                   // kind of expression
+   CodePointRangeVector ranges;                 // sorted ranges of a CLASS
+   std::vector<int> children;                   // indices of the child nodes
+   int minRepeat = 0;                           // minimum count of REPETITION
+   int maxRepeat = 0;                           // maximum count, -1 if none
+   int height = 1;                              // nodes on the longest path down
+   size_t expandedSize = 0;                     // NFA-e nodes and transitions built
+};
+
+// Data for the regex conversion algorithm
+struct RegexConversionData {
+   std::vector<int> pattern;
+   size_t position = 0;
+   int groupDepth = 0;
+   std::vector<RegexNode> regexNodes;
+   FiniteStateMachine nfaEpsilon;
+   int nodeNumber = 0;
+};
+
+// Function Prototypes
+int addNfaNode(RegexConversionData&);
+void addNfaTransition(RegexConversionData&, int, int, int, int);
+int addRegexNode(RegexConversionData&, RegexNode::Kind);
+int buildNfaEpsilon(RegexConversionData&, int, int);
+int getOnlyLiveTransition(const std::vector<int>&, const std::vector<bool>&);
+void negateRanges(CodePointRangeVector&);
+void normalizeRanges(CodePointRangeVector&);
+int parseAlternation(RegexConversionData&);
+int parseAtom(RegexConversionData&);
+void parseCharacterClass(RegexConversionData&, CodePointRangeVector&);
+int parseConcatenation(RegexConversionData&);
+void parseEscape(RegexConversionData&, CodePointRangeVector&);
+int parseHexDigits(RegexConversionData&, size_t);
+int parseRepeatCount(RegexConversionData&);
+int parseRepetition(RegexConversionData&);
+int peekPatternChar(const RegexConversionData&);
+void setRegexNodeChildren(RegexConversionData&, int, const std::vector<int>&);
+void throwRegexError(const RegexConversionData&, const std::string&);
+
+/*******************************************************************************
+ * Convert Regex to NfaEpsilon
+ * Takes a regular expression and compiles it to an equivalent NFA-epsilon over
+ * UTF-8 bytes. This process takes O(m) time where m is the size of the pattern
+ * after bounded repetitions are expanded.
+ * @param pattern       a UTF-8 regular expression
+ * @return              a NFA-epsilon FiniteStateMachine
+ */
+FiniteStateMachine convertRegexToNfaEpsilon(const std::string& pattern) {
+   RegexConversionData regexData;
+   for (size_t position = 0; position < pattern.length();) {
+      int codePoint = decodeUtf8(pattern, position);
+      if (codePoint == -1) {
+         throw std::invalid_argument("regex is not valid UTF-8");
+      }
+      regexData.pattern.push_back(codePoint);
+   }
+   int rootNode = parseAlternation(regexData);
+   if (regexData.position < regexData.pattern.size()) {
+      throwRegexError(regexData, "unmatched ')'");
+   }
+   // Build the NFA-epsilon over code points
+   regexData.nfaEpsilon.startNode = addNfaNode(regexData);
+   int goalNode = buildNfaEpsilon(regexData, rootNode, regexData.nfaEpsilon.startNode);
+   regexData.nfaEpsilon.goalNodes.insert(goalNode);
+   removeRedundantEpsilonTransitions(regexData.nfaEpsilon);
+   return lowerCodePointsToUtf8(regexData.nfaEpsilon);
+}
+
+/*******************************************************************************
+ * Remove Redundant Epsilon Transitions
+ * Simplifies a NFA-epsilon in place without changing its language. Epsilon
+ * self loops and duplicate transitions are dropped, a node whose only way out
+ * is one epsilon transition is replaced by its destination, and a node whose
+ * only way in is one epsilon transition is merged into its source.
+ * This process takes O(n + t) time where n is the number of nodes and t is the
+ * number of transitions.
+ * @param fsm           a reference to a NFA-epsilon FiniteStateMachine
+ */
+void removeRedundantEpsilonTransitions(FiniteStateMachine& fsm) {
+   std::vector<Transition> transitions(fsm.transitions.cbegin(), fsm.transitions.cend());
+   std::vector<bool> removed(transitions.size(), false);
+   MapNodeToTransitionIndices outgoing;
+   MapNodeToTransitionIndices incoming;
+   for (size_t i = 0; i < transitions.size(); i++) {
+      if (transitions[i].transitionChar == FiniteStateMachine::EPSILON &&
+          transitions[i].source == transitions[i].destination) {
+         removed[i] = true;
+         continue;
+      }
+      outgoing[transitions[i].source].push_back(static_cast<int>(i));
+      incoming[transitions[i].destination].push_back(static_cast<int>(i));
+   }
+   std::vector<int> pendingNodes(fsm.nodes.cbegin(), fsm.nodes.cend());
+   while (!pendingNodes.empty()) {
+      int node = pendingNodes.back();
+      pendingNodes.pop_back();
+      if (fsm.nodes.count(node) == 0) {
+         continue;
+      }
+      // Replace a non-goal node left only by epsilon with its destination
+      int onlyOutgoing = getOnlyLiveTransition(outgoing[node], removed);
+      if (onlyOutgoing != -1 &&
+          transitions[onlyOutgoing].transitionChar == FiniteStateMachine::EPSILON &&
+          fsm.goalNodes.count(node) == 0) {
+         int target = transitions[onlyOutgoing].destination;
+         removed[onlyOutgoing] = true;
+         for (int i : incoming[node]) {
+            if (removed[i]) {
+               continue;
+            }
+            transitions[i].destination = target;
+            if (transitions[i].transitionChar == FiniteStateMachine::EPSILON &&
+                transitions[i].source == target) {
+               removed[i] = true;
+            } else {
+               incoming[target].push_back(i);
+               pendingNodes.push_back(transitions[i].source);
+            }
+         }
+         if (fsm.startNode == node) {
+            fsm.startNode = target;
+         }
+         fsm.nodes.erase(node);
+         outgoing.erase(node);
+         incoming.erase(node);
+         pendingNodes.push_back(target);
+         continue;
+      }
+      // Merge a node entered only by epsilon into its source
+      int onlyIncoming = getOnlyLiveTransition(incoming[node], removed);
+      if (onlyIncoming != -1 &&
+          transitions[onlyIncoming].transitionChar == FiniteStateMachine::EPSILON &&
+          fsm.startNode != node) {
+         int source = transitions[onlyIncoming].source;
+         removed[onlyIncoming] = true;
+         for (int i : outgoing[node]) {
+            if (removed[i]) {
+               continue;
+            }
+            transitions[i].source = source;
+            if (transitions[i].transitionChar == FiniteStateMachine::EPSILON &&
+                transitions[i].destination == source) {
+               removed[i] = true;
+            } else {
+               outgoing[source].push_back(i);
+               pendingNodes.push_back(transitions[i].destination);
+            }
+         }
+         if (fsm.goalNodes.erase(node) > 0) {
+            fsm.goalNodes.insert(source);
+         }
+         fsm.nodes.erase(node);
+         outgoing.erase(node);
+         incoming.erase(node);
+         pendingNodes.push_back(source);
+      }
+   }
+   // Keep one copy of every remaining transition
+   std::set<std::tuple<int, int, int, int> > seenTransitions;
+   fsm.transitions.clear();
+   for (size_t i = 0; i < transitions.size(); i++) {
+      const Transition& transition = transitions[i];
+      if (!removed[i] &&
+          seenTransitions.insert(std::make_tuple(transition.source, transition.transitionChar,
+                                                 transition.getLastTransitionChar(),
+                                                 transition.destination)).second) {
+         fsm.transitions.push_back(transition);
+      }
+   }
+}
+
+/*******************************************************************************
+ * Add NFA Node
+ * A helper method to add a new node to the NFA-epsilon.
+ * @param regexData     a reference to the regex conversion data
+ * @return              the new node
+ */
+int addNfaNode(RegexConversionData& regexData) {
+   regexData.nfaEpsilon.nodes.insert(regexData.nodeNumber);
+   return regexData.nodeNumber++;
+}
+
+/*******************************************************************************
+ * Add NFA Transition
+ * A helper method to add a range labeled or epsilon transition to the
+ * NFA-epsilon. Epsilon self loops are never added, and epsilon transitions
+ * are stored as single symbols.
+ * @param regexData     a reference to the regex conversion data
+ * @param source        the source node
+ * @param firstCharacter
+ *                      the first symbol of the range, or EPSILON
+ * @param lastCharacter the last symbol of the range, or EPSILON
+ * @param destination   the destination node
+ */
+void addNfaTransition(RegexConversionData& regexData, int source, int firstCharacter,
+                      int lastCharacter, int destination) {
+   if (firstCharacter == FiniteStateMachine::EPSILON && source == destination) {
+      return;
+   }
+   Transition theTransition;
+   theTransition.source = source;
+   theTransition.transitionChar = firstCharacter;
+   theTransition.lastTransitionChar =
+      firstCharacter == FiniteStateMachine::EPSILON ? Transition::SINGLE_CHAR : lastCharacter;
+   theTransition.destination = destination;
+   regexData.nfaEpsilon.transitions.push_back(theTransition);
+}
+
+/*******************************************************************************
+ * Add Regex Node
+ * A helper method to add a new node to the parsed regular expression.
+ * @param regexData     a reference to the regex conversion data
+ * @param kind          the kind of the new node
+ * @return              the index of the new node
+ */
+int addRegexNode(RegexConversionData& regexData, RegexNode::Kind kind) {
+   RegexNode regexNode;
+   regexNode.kind = kind;
+   regexData.regexNodes.push_back(regexNode);
+   return static_cast<int>(regexData.regexNodes.size()) - 1;
+}
+
+/*******************************************************************************
+ * Build NfaEpsilon
+ * A helper method to build the fragment for a regex node, starting at an
+ * existing node. Fragments only add transitions leaving the start node and
+ * only add transitions into nodes they create themselves, which lets
+ * concatenated fragments share their boundary nodes.
+ * @param regexData     a reference to the regex conversion data
+ * @param regexNodeIndex
+ *                      the index of the regex node to build
+ * @param startNode     the node the fragment starts at
+ * @return              the node the fragment ends at
+ */
+int buildNfaEpsilon(RegexConversionData& regexData, int regexNodeIndex, int startNode) {
+   const RegexNode& regexNode = regexData.regexNodes[regexNodeIndex];
+   int currentNode = startNode;
+   switch (regexNode.kind) {
+      case RegexNode::EMPTY:
+         return startNode;
+      case RegexNode::CLASS: {
+         int endNode = addNfaNode(regexData);
+         for (const auto& range : regexNode.ranges) {
+            addNfaTransition(regexData, startNode, range.first, range.second, endNode);
+         }
+         return endNode;
+      }
+      case RegexNode::CONCATENATION:
+         for (int child : regexNode.children) {
+            currentNode = buildNfaEpsilon(regexData, child, currentNode);
+         }
+         return currentNode;
+      case RegexNode::ALTERNATION: {
+         int endNode = addNfaNode(regexData);
+         for (int child : regexNode.children) {
+            int branchEndNode = buildNfaEpsilon(regexData, child, startNode);
+            addNfaTransition(regexData, branchEndNode, FiniteStateMachine::EPSILON,
+                             FiniteStateMachine::EPSILON, endNode);
+         }
+         return endNode;
+      }
+      case RegexNode::REPETITION: {
+         int child = regexNode.children.front();
+         for (int i = 0; i < regexNode.minRepeat; i++) {
+            currentNode = buildNfaEpsilon(regexData, child, currentNode);
+         }
+         if (regexNode.maxRepeat == -1) {
+            // Loop on a new node so the loop cannot reach earlier fragments
+            int loopNode = addNfaNode(regexData);
+            addNfaTransition(regexData, currentNode, FiniteStateMachine::EPSILON,
+                             FiniteStateMachine::EPSILON, loopNode);
+            int childEndNode = buildNfaEpsilon(regexData, child, loopNode);
+            addNfaTransition(regexData, childEndNode, FiniteStateMachine::EPSILON,
+                             FiniteStateMachine::EPSILON, loopNode);
+            return loopNode;
+         }
+         for (int i = regexNode.minRepeat; i < regexNode.maxRepeat; i++) {
+            int childEndNode = buildNfaEpsilon(regexData, child, currentNode);
+            int nextNode = addNfaNode(regexData);
+            addNfaTransition(regexData, childEndNode, FiniteStateMachine::EPSILON,
+                             FiniteStateMachine::EPSILON, nextNode);
+            addNfaTransition(regexData, currentNode, FiniteStateMachine::EPSILON,
+                             FiniteStateMachine::EPSILON, nextNode);
+            currentNode = nextNode;
+         }
+         return currentNode;
+      }
+   }
+   return currentNode;
+}
+
+/*******************************************************************************
+ * Get Only Live Transition
+ * A helper method to find the single transition of a node that has not been
+ * removed.
+ * @param transitionIndices
+ *                      the indices of the transitions of a node
+ * @param removed       the removed flag of every transition
+ * @return              the index of the only live transition, or -1 if there
+ *                      is not exactly one
+ */
+int getOnlyLiveTransition(const std::vector<int>& transitionIndices,
+                          const std::vector<bool>& removed) {
+   int onlyTransition = -1;
+   for (int i : transitionIndices) {
+      if (removed[i]) {
+         continue;
+      }
+      if (onlyTransition != -1) {
+         return -1;
+      }
+      onlyTransition = i;
+   }
+   return onlyTransition;
+}
+
+/*******************************************************************************
+ * Negate Ranges
+ * A helper method to replace a set of code point ranges with its complement
+ * within [0, MAX_CODE_POINT].
+ * @param ranges        a reference to a vector of code point ranges
+ */
+void negateRanges(CodePointRangeVector& ranges) {
+   normalizeRanges(ranges);
+   CodePointRangeVector negatedRanges;
+   int nextCodePoint = 0;
+   for (const auto& range : ranges) {
+      if (range.first > nextCodePoint) {
+         negatedRanges.push_back(CodePointRange(nextCodePoint, range.first - 1));
+      }
+      nextCodePoint = range.second + 1;
+   }
+   if (nextCodePoint <= MAX_CODE_POINT) {
+      negatedRanges.push_back(CodePointRange(nextCodePoint, MAX_CODE_POINT));
+   }
+   ranges.swap(negatedRanges);
+}
+
+/*******************************************************************************
+ * Normalize Ranges
+ * A helper method to sort a set of code point ranges and merge the ranges
+ * that overlap or touch.
+ * @param ranges        a reference to a vector of code point ranges
+ */
+void normalizeRanges(CodePointRangeVector& ranges) {
+   std::sort(ranges.begin(), ranges.end());
+   CodePointRangeVector mergedRanges;
+   for (const auto& range : ranges) {
+      if (!mergedRanges.empty() && range.first <= mergedRanges.back().second + 1) {
+         mergedRanges.back().second = std::max(mergedRanges.back().second, range.second);
+      } else {
+         mergedRanges.push_back(range);
+      }
+   }
+   ranges.swap(mergedRanges);
+}
+
+/*******************************************************************************
+ * Parse Alternation
+ * A helper method to parse concatenations separated by '|'.
+ * @param regexData     a reference to the regex conversion data
+ * @return              the index of the parsed regex node
+ */
+int parseAlternation(RegexConversionData& regexData) {
+   int firstBranch = parseConcatenation(regexData);
+   if (peekPatternChar(regexData) != '|') {
+      return firstBranch;
+   }
+   std::vector<int> branches(1, firstBranch);
+   while (peekPatternChar(regexData) == '|') {
+      regexData.position++;
+      branches.push_back(parseConcatenation(regexData));
+   }
+   int alternation = addRegexNode(regexData, RegexNode::ALTERNATION);
+   setRegexNodeChildren(regexData, alternation, branches);
+   return alternation;
+}
+
+/*******************************************************************************
+ * Parse Atom
+ * A helper method to parse a group, character class, wildcard, escape, or
+ * literal code point.
+ * @param regexData     a reference to the regex conversion data
+ * @return              the index of the parsed regex node
+ */
+int parseAtom(RegexConversionData& regexData) {
+   int patternChar = regexData.pattern[regexData.position++];
+   CodePointRangeVector ranges;
+   switch (patternChar) {
+      case '(': {
+         if (++regexData.groupDepth > MAX_REGEX_NESTING) {
+            regexData.position--;
+            throwRegexError(regexData, "groups nested too deeply");
+         }
+         if (peekPatternChar(regexData) == '?') {
+            if (regexData.position + 1 >= regexData.pattern.size() ||
+                regexData.pattern[regexData.position + 1] != ':') {
+               throwRegexError(regexData, "unsupported group syntax");
+            }
+            regexData.position += 2;
+         }
+         int group = parseAlternation(regexData);
+         if (peekPatternChar(regexData) != ')') {
+            throwRegexError(regexData, "missing ')'");
+         }
+         regexData.position++;
+         regexData.groupDepth--;
+         return group;
+      }
+      case '[':
+         parseCharacterClass(regexData, ranges);
+         break;
+      case '.':
+         ranges.push_back(CodePointRange('\n', '\n'));
+         negateRanges(ranges);
+         break;
+      case '\\':
+         parseEscape(regexData, ranges);
+         break;
+      case '*':
+      case '+':
+      case '?':
+      case '{':
+         regexData.position--;
+         throwRegexError(regexData, "nothing to repeat");
+         break;
+      case '^':
+      case '$':
+         regexData.position--;
+         throwRegexError(regexData, "anchors are not supported");
+         break;
+      default:
+         ranges.push_back(CodePointRange(patternChar, patternChar));
+         break;
+   }
+   int characterClass = addRegexNode(regexData, RegexNode::CLASS);
+   normalizeRanges(ranges);
+   regexData.regexNodes[characterClass].expandedSize = 1 + ranges.size();
+   regexData.regexNodes[characterClass].ranges.swap(ranges);
+   return characterClass;
+}
+
+/*******************************************************************************
+ * Parse Character Class
+ * A helper method to parse the items of a character class after its '['. A
+ * ']' right after the '[' or '[^' is a literal.
+ * @param regexData     a reference to the regex conversion data
+ * @param ranges        a reference to the vector of ranges to fill
+ */
+void parseCharacterClass(RegexConversionData& regexData, CodePointRangeVector& ranges) {
+   bool isNegated = false;
+   if (peekPatternChar(regexData) == '^') {
+      isNegated = true;
+      regexData.position++;
+   }
+   bool isFirstItem = true;
+   while (peekPatternChar(regexData) != ']' || isFirstItem) {
+      if (peekPatternChar(regexData) == -1) {
+         throwRegexError(regexData, "missing ']'");
+      }
+      isFirstItem = false;
+      CodePointRangeVector itemRanges;
+      int itemChar = regexData.pattern[regexData.position++];
+      if (itemChar == '\\') {
+         parseEscape(regexData, itemRanges);
+      } else {
+         itemRanges.push_back(CodePointRange(itemChar, itemChar));
+      }
+      // A single code point followed by '-' and not ']' starts a range
+      bool isSingleCodePoint = itemRanges.size() == 1 &&
+                               itemRanges.front().first == itemRanges.front().second;
+      if (isSingleCodePoint && peekPatternChar(regexData) == '-' &&
+          regexData.position + 1 < regexData.pattern.size() &&
+          regexData.pattern[regexData.position + 1] != ']') {
+         regexData.position++;
+         CodePointRangeVector lastRanges;
+         int lastChar = regexData.pattern[regexData.position++];
+         if (lastChar == '\\') {
+            parseEscape(regexData, lastRanges);
+         } else {
+            lastRanges.push_back(CodePointRange(lastChar, lastChar));
+         }
+         if (lastRanges.size() != 1 || lastRanges.front().first != lastRanges.front().second) {
+            throwRegexError(regexData, "invalid range end in character class");
+         }
+         if (lastRanges.front().first < itemRanges.front().first) {
+            throwRegexError(regexData, "out of order range in character class");
+         }
+         itemRanges.front().second = lastRanges.front().first;
+      }
+      ranges.insert(ranges.end(), itemRanges.cbegin(), itemRanges.cend());
+   }
+   regexData.position++;
+   if (isNegated) {
+      negateRanges(ranges);
+   }
+}
+
+/*******************************************************************************
+ * Parse Concatenation
+ * A helper method to parse a sequence of repetitions up to a '|' or ')'.
+ * @param regexData     a reference to the regex conversion data
+ * @return              the index of the parsed regex node
+ */
+int parseConcatenation(RegexConversionData& regexData) {
+   std::vector<int> children;
+   while (peekPatternChar(regexData) != -1 && peekPatternChar(regexData) != '|' &&
+          peekPatternChar(regexData) != ')') {
+      children.push_back(parseRepetition(regexData));
+   }
+   if (children.size() == 1) {
+      return children.front();
+   }
+   int concatenation = addRegexNode(regexData, children.empty() ? RegexNode::EMPTY
+                                                     : RegexNode::CONCATENATION);
+   setRegexNodeChildren(regexData, concatenation, children);
+   return concatenation;
+}
+
+/*******************************************************************************
+ * Parse Escape
+ * A helper method to parse an escape sequence after its '\'.
+ * @param regexData     a reference to the regex conversion data
+ * @param ranges        a reference to the vector of ranges to append to
+ */
+void parseEscape(RegexConversionData& regexData, CodePointRangeVector& ranges) {
+   if (peekPatternChar(regexData) == -1) {
+      throwRegexError(regexData, "trailing '\\'");
+   }
+   int escapeChar = regexData.pattern[regexData.position++];
+   CodePointRangeVector escapeRanges;
+   switch (escapeChar) {
+      case 'd':
+      case 'D':
+         escapeRanges.push_back(CodePointRange('0', '9'));
+         break;
+      case 'w':
+      case 'W':
+         escapeRanges.push_back(CodePointRange('0', '9'));
+         escapeRanges.push_back(CodePointRange('A', 'Z'));
+         escapeRanges.push_back(CodePointRange('_', '_'));
+         escapeRanges.push_back(CodePointRange('a', 'z'));
+         break;
+      case 's':
+      case 'S':
+         escapeRanges.push_back(CodePointRange('\t', '\r'));
+         escapeRanges.push_back(CodePointRange(' ', ' '));
+         break;
+      case 'n':
+         escapeRanges.push_back(CodePointRange('\n', '\n'));
+         break;
+      case 'r':
+         escapeRanges.push_back(CodePointRange('\r', '\r'));
+         break;
+      case 't':
+         escapeRanges.push_back(CodePointRange('\t', '\t'));
+         break;
+      case 'f':
+         escapeRanges.push_back(CodePointRange('\f', '\f'));
+         break;
+      case 'v':
+         escapeRanges.push_back(CodePointRange('\v', '\v'));
+         break;
+      case '0':
+         escapeRanges.push_back(CodePointRange(0, 0));
+         break;
+      case 'x': {
+         int codePoint = 0;
+         if (peekPatternChar(regexData) == '{') {
+            regexData.position++;
+            size_t closePosition = regexData.position;
+            while (closePosition < regexData.pattern.size() &&
+                   regexData.pattern[closePosition] != '}') {
+               closePosition++;
+            }
+            if (closePosition == regexData.pattern.size() ||
+                closePosition == regexData.position || closePosition - regexData.position > 6) {
+               throwRegexError(regexData, "invalid \\x{...} escape");
+            }
+            codePoint = parseHexDigits(regexData, closePosition - regexData.position);
+            regexData.position++;
+         } else {
+            codePoint = parseHexDigits(regexData, 2);
+         }
+         if (codePoint > MAX_CODE_POINT) {
+            throwRegexError(regexData, "code point out of range");
+         }
+         escapeRanges.push_back(CodePointRange(codePoint, codePoint));
+         break;
+      }
+      default:
+         if ((escapeChar >= '0' && escapeChar <= '9') ||
+             (escapeChar >= 'A' && escapeChar <= 'Z') ||
+             (escapeChar >= 'a' && escapeChar <= 'z')) {
+            regexData.position--;
+            throwRegexError(regexData, "unsupported escape");
+         }
+         escapeRanges.push_back(CodePointRange(escapeChar, escapeChar));
+         break;
+   }
+   if (escapeChar == 'D' || escapeChar == 'W' || escapeChar == 'S') {
+      negateRanges(escapeRanges);
+   }
+   ranges.insert(ranges.end(), escapeRanges.cbegin(), escapeRanges.cend());
+}
+
+/*******************************************************************************
+ * Parse Hex Digits
+ * A helper method to parse a fixed number of hexadecimal digits.
+ * @param regexData     a reference to the regex conversion data
+ * @param digitCount    the number of digits to parse
+ * @return              the parsed value
+ */
+int parseHexDigits(RegexConversionData& regexData, size_t digitCount) {
+   int value = 0;
+   for (size_t i = 0; i < digitCount; i++) {
+      int digit = peekPatternChar(regexData);
+      if (digit >= '0' && digit <= '9') {
+         value = value * 16 + (digit - '0');
+      } else if (digit >= 'a' && digit <= 'f') {
+         value = value * 16 + (digit - 'a' + 10);
+      } else if (digit >= 'A' && digit <= 'F') {
+         value = value * 16 + (digit - 'A' + 10);
+      } else {
+         throwRegexError(regexData, "invalid hexadecimal digit");
+      }
+      regexData.position++;
+   }
+   return value;
+}
+
+/*******************************************************************************
+ * Parse Repeat Count
+ * A helper method to parse the decimal count of a bounded repetition.
+ * @param regexData     a reference to the regex conversion data
+ * @return              the parsed count
+ */
+int parseRepeatCount(RegexConversionData& regexData) {
+   int count = 0;
+   bool hasDigits = false;
+   while (peekPatternChar(regexData) >= '0' && peekPatternChar(regexData) <= '9') {
+      count = count * 10 + (regexData.pattern[regexData.position++] - '0');
+      hasDigits = true;
+      if (count > MAX_REGEX_REPEAT) {
+         throwRegexError(regexData, "repetition count too large");
+      }
+   }
+   if (!hasDigits) {
+      throwRegexError(regexData, "missing repetition count");
+   }
+   return count;
+}
+
+/*******************************************************************************
+ * Parse Repetition
+ * A helper method to parse an atom followed by any number of '*', '+', '?', or
+ * bounded repetition operators.
+ * @param regexData     a reference to the regex conversion data
+ * @return              the index of the parsed regex node
+ */
+int parseRepetition(RegexConversionData& regexData) {
+   int repeatedNode = parseAtom(regexData);
+   while (true) {
+      int minRepeat = 0;
+      int maxRepeat = -1;
+      int operatorChar = peekPatternChar(regexData);
+      if (operatorChar == '+') {
+         minRepeat = 1;
+      } else if (operatorChar == '?') {
+         maxRepeat = 1;
+      } else if (operatorChar == '{') {
+         regexData.position++;
+         minRepeat = parseRepeatCount(regexData);
+         maxRepeat = minRepeat;
+         if (peekPatternChar(regexData) == ',') {
+            regexData.position++;
+            maxRepeat = peekPatternChar(regexData) == '}' ? -1 : parseRepeatCount(regexData);
+         }
+         if (peekPatternChar(regexData) != '}') {
+            throwRegexError(regexData, "missing '}'");
+         }
+         if (maxRepeat != -1 && maxRepeat < minRepeat) {
+            throwRegexError(regexData, "out of order repetition counts");
+         }
+      } else if (operatorChar != '*') {
+         return repeatedNode;
+      }
+      regexData.position++;
+      int repetition = addRegexNode(regexData, RegexNode::REPETITION);
+      regexData.regexNodes[repetition].minRepeat = minRepeat;
+      regexData.regexNodes[repetition].maxRepeat = maxRepeat;
+      setRegexNodeChildren(regexData, repetition, std::vector<int>(1, repeatedNode));
+      repeatedNode = repetition;
+   }
+}
+
+/*******************************************************************************
+ * Peek Pattern Char
+ * A helper method to look at the next code point of the pattern.
+ * @param regexData     a reference to the regex conversion data
+ * @return              the next code point, or -1 at the end of the pattern
+ */
+int peekPatternChar(const RegexConversionData& regexData) {
+   if (regexData.position >= regexData.pattern.size()) {
+      return -1;
+   }
+   return regexData.pattern[regexData.position];
+}
+
+/*******************************************************************************
+ * Set Regex Node Children
+ * A helper method to give a regex node its children, and to check that the
+ * tree does not get too deep or expand to too many NFA-epsilon nodes and
+ * transitions to build. The expanded size of a node counts what
+ * buildNfaEpsilon adds for it, so nested repetitions multiply.
+ * @param regexData     a reference to the regex conversion data
+ * @param regexNodeIndex
+ *                      the index of the parent regex node
+ * @param children      the indices of the child nodes
+ */
+void setRegexNodeChildren(RegexConversionData& regexData, int regexNodeIndex,
+                          const std::vector<int>& children) {
+   RegexNode& regexNode = regexData.regexNodes[regexNodeIndex];
+   regexNode.children = children;
+   for (int child : children) {
+      regexNode.height = std::max(regexNode.height, regexData.regexNodes[child].height + 1);
+   }
+   if (regexNode.height > MAX_REGEX_NESTING) {
+      throwRegexError(regexData, "expression nested too deeply");
+   }
+   size_t childrenSize = 0;
+   for (int child : children) {
+      childrenSize += regexData.regexNodes[child].expandedSize;
+   }
+   switch (regexNode.kind) {
+      case RegexNode::ALTERNATION:
+         // an end node, and an epsilon transition into it from every branch
+         regexNode.expandedSize = 1 + children.size() + childrenSize;
+         break;
+      case RegexNode::REPETITION: {
+         // the required copies, then a loop node with two epsilon transitions
+         // or a node with two epsilon transitions after every optional copy
+         size_t minRepeat = regexNode.minRepeat;
+         size_t optionalCopies = regexNode.maxRepeat == -1 ? 1 : regexNode.maxRepeat - minRepeat;
+         regexNode.expandedSize = minRepeat * childrenSize + optionalCopies * (childrenSize + 3);
+         break;
+      }
+      default:
+         regexNode.expandedSize = childrenSize;
+         break;
+   }
+   if (regexNode.expandedSize > MAX_REGEX_EXPANDED_SIZE) {
+      throwRegexError(regexData, "expression expands to too many nodes");
+   }
+}
+
+/*******************************************************************************
+ * Throw Regex Error
+ * A helper method to report an invalid pattern at the current position.
+ * @param regexData     a reference to the regex conversion data
+ * @param message       a description of the error
+ */
+void throwRegexError(const RegexConversionData& regexData, const std::string& message) {
+   throw std::invalid_argument("regex error at position " +
+                               std::to_string(regexData.position) + ": " + message);
+}
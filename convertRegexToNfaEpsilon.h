@@ -0,0 +1,36 @@
+/*******************************************************************************
+ *  @author             Karl Jansen (kmjansen@uw.edu)
+ *  @version            1.2, 03/16/2015
+ *
+ *  Compilation:        N/A
+ *  Execution:          N/A
+ *  Dependencies:       lowerCodePointsToUtf8.h;
+ *
+ *  Description:
+ *  This file declares the functions used to compile a regular expression into
+ *  an equivalent NFA-epsilon FiniteStateMachine.
+ *
+ *  Functionality:
+ *  Provides the prototypes for the regex front end and its epsilon transition
+ *  optimization pass.
+ *
+*******************************************************************************/
+
+#ifndef CONVERTREGEXTONFAEPSILON_H
+#define CONVERTREGEXTONFAEPSILON_H
+
+#include "lowerCodePointsToUtf8.h"
+#include <stdexcept>
+#include <string>
+
+static const int MAX_REGEX_REPEAT = 1000;       // largest bounded repetition
+static const int MAX_REGEX_NESTING = 1000;      // deepest nesting of groups
+// most NFA-epsilon nodes and transitions a pattern may expand to, counting
+// every copy that bounded repetitions make, even inside other repetitions
+static const size_t MAX_REGEX_EXPANDED_SIZE = 1000000;
+
+// Function Prototypes
+FiniteStateMachine convertRegexToNfaEpsilon(const std::string&);
+void removeRedundantEpsilonTransitions(FiniteStateMachine&);
+
+#endif
@@ -0,0 +1,82 @@
+/*******************************************************************************
+ *  @author             Karl Jansen (kmjansen@uw.edu)
+ *  @version            1.2, 03/16/2015
+ *
+ *  Compilation:        N/A
+ *  Execution:          N/A
+ *  Dependencies:       indexStates.h;
+ *
+ *  Description:
+ *  This program numbers the nodes of a Finite State Machine densely, and
+ *  groups its transitions by state index.
+ *
+ *  Functionality:
+ *  Nodes are numbered in the order they are first seen, so a caller decides
+ *  which states come first, such as the start state. Transitions are grouped
+ *  with a counting sort, which keeps the transitions of a state in their
+ *  original order and takes O(t + s) time, where t is the number of
+ *  transitions and s is the number of states.
+ *
+ *  Assumptions:
+ *  The transitions passed to bucketTransitions already use state indices.
+ *
+*******************************************************************************/
+
+// Guarded, since the headers of every class that numbers its states include
+// this file
+#ifndef INDEXSTATES_CPP
+#define INDEXSTATES_CPP
+
+#include "indexStates.h"
+
+/*******************************************************************************
+ * Bucket Transitions
+ * Lists the indices of transitions grouped by source or by destination state,
+ * with a counting sort.
+ * @param transitions   the transitions, with dense state indices
+ * @param stateCount    the number of states
+ * @param isBySource    whether to group by source instead of destination
+ * @param offsets       a reference to the offsets to fill in, where state i
+ *                      owns transitionIndices[offsets[i], offsets[i + 1])
+ * @param transitionIndices
+ *                      a reference to the grouped transition indices to fill in
+ */
+void bucketTransitions(const std::vector<Transition>& transitions, int stateCount,
+                       bool isBySource, std::vector<int>& offsets,
+                       std::vector<int>& transitionIndices) {
+   offsets.assign(stateCount + 1, 0);
+   for (const auto& transition : transitions) {
+      offsets[(isBySource ? transition.source : transition.destination) + 1]++;
+   }
+   for (size_t i = 1; i < offsets.size(); i++) {
+      offsets[i] += offsets[i - 1];
+   }
+   std::vector<int> nextSlot(offsets.begin(), offsets.end() - 1);
+   transitionIndices.resize(transitions.size());
+   for (size_t i = 0; i < transitions.size(); i++) {
+      const Transition& transition = transitions[i];
+      transitionIndices[nextSlot[isBySource ? transition.source : transition.destination]++] =
+         static_cast<int>(i);
+   }
+}
+
+/*******************************************************************************
+ * Get State Index
+ * Finds the dense state index of a node, assigning the next free index to a
+ * node seen for the first time.
+ * @param stateIndices  a reference to the state index of every node seen
+ * @param stateCount    a reference to the next free index, which is advanced
+ *                      when a node is seen for the first time
+ * @param node          a node of the original finite state machine
+ * @return              the state index of the node
+ */
+int getStateIndex(MapNodeToStateIndex& stateIndices, int& stateCount, int node) {
+   MapNodeToStateIndex::const_iterator indexItr = stateIndices.find(node);
+   if (indexItr != stateIndices.cend()) {
+      return indexItr->second;
+   }
+   stateIndices[node] = stateCount;
+   return stateCount++;
+}
+
+#endif
@@ -0,0 +1,33 @@
+/*******************************************************************************
+ *  @author             Karl Jansen (kmjansen@uw.edu)
+ *  @version            1.2, 03/16/2015
+ *
+ *  Compilation:        N/A
+ *  Execution:          N/A
+ *  Dependencies:       Transition.cpp;
+ *
+ *  Description:
+ *  This file declares the functions used to number the nodes of a Finite
+ *  State Machine densely, and to group its transitions by state index.
+ *
+ *  Functionality:
+ *  Provides the prototypes for the dense state index and counting sort helpers
+ *  shared by the compiled automata and the Prefilter.
+ *
+*******************************************************************************/
+
+#ifndef INDEXSTATES_H
+#define INDEXSTATES_H
+
+#include "Transition.cpp"
+#include <unordered_map>
+#include <vector>
+
+typedef std::unordered_map<int, int> MapNodeToStateIndex;
+
+// Function Prototypes
+void bucketTransitions(const std::vector<Transition>&, int, bool, std::vector<int>&,
+                       std::vector<int>&);
+int getStateIndex(MapNodeToStateIndex&, int&, int);
+
+#endif
@@ -0,0 +1,312 @@
+/*******************************************************************************
+ *  @author             Karl Jansen (kmjansen@uw.edu)
+ *  @version            1.2, 03/16/2015
+ *
+ *  Compilation:        N/A
+ *  Execution:          N/A
+ *  Dependencies:       lowerCodePointsToUtf8.h;
+ *
+ *  Description:
+ *  This program lowers a FiniteStateMachine whose transition characters are
+ *  Unicode code points into an equivalent FiniteStateMachine whose transition
+ *  characters are UTF-8 bytes.
+ *
+ *  Functionality:
+ *  The code point ranges on each edge of the input machine are merged, and
+ *  every merged range is split into the minimal list of UTF-8 byte range
+ *  sequences that encode it. Each sequence becomes a chain of byte range
+ *  transitions through new intermediate nodes, with common leading ranges
+ *  shared. The
+ *  result can be converted and compiled like any byte-level machine, so
+ *  multilingual text is matched directly on its UTF-8 bytes without decoding.
+ *
+ *  Assumptions:
+ *  Every non-epsilon transition label of the input is a code point or a range
+ *  of code points. Values above MAX_CODE_POINT and surrogate code points
+ *  (U+D800 to U+DFFF) have no UTF-8 encoding and are dropped.
+ *
+*******************************************************************************/
+
+#include "lowerCodePointsToUtf8.h"
+#include <algorithm>
+#include <map>
+#include <utility>
+
+// Definitions
+typedef std::pair<int, int> EdgePair;
+typedef std::map<EdgePair, std::vector<EdgePair> > MapEdgeToCodePointRanges;
+typedef std::pair<int, EdgePair> Utf8TrieKey;
+typedef std::map<Utf8TrieKey, int> MapUtf8TrieKeyToNode;
+
+// Function Prototypes
+void addUtf8ByteTransition(FiniteStateMachine&, int, const Utf8ByteRange&, int);
+void addUtf8Sequence(FiniteStateMachine&, MapUtf8TrieKeyToNode&, const Utf8Sequence&, int, int, int&);
+int getNextFreeNode(const FiniteStateMachine&);
+
+/*******************************************************************************
+ * Lower Code Points to UTF-8
+ * Takes a FiniteStateMachine over Unicode code points and converts it to an
+ * equivalent FiniteStateMachine over UTF-8 bytes. Node ids of the input are
+ * preserved, and new intermediate nodes are numbered after the largest one.
+ * This process takes O(t log t) time where t is the number of transitions.
+ * @param codePointFsm  a reference to a code point FiniteStateMachine
+ * @return              a byte-level FiniteStateMachine
+ */
+FiniteStateMachine lowerCodePointsToUtf8(const FiniteStateMachine& codePointFsm) {
+   codePointFsm.checkSymbols();
+   FiniteStateMachine byteFsm;
+   byteFsm.nodes = codePointFsm.nodes;
+   byteFsm.startNode = codePointFsm.startNode;
+   byteFsm.goalNodes = codePointFsm.goalNodes;
+   int nextNode = getNextFreeNode(codePointFsm);
+   // Group the code point ranges by edge, keeping epsilon transitions as they are
+   MapEdgeToCodePointRanges codePointRangesByEdge;
+   for (const auto& transition : codePointFsm.transitions) {
+      if (transition.transitionChar == FiniteStateMachine::EPSILON) {
+         byteFsm.transitions.push_back(transition);
+      } else {
+         EdgePair edge(transition.source, transition.destination);
+         codePointRangesByEdge[edge].push_back(EdgePair(transition.transitionChar,
+                                                        transition.getLastTransitionChar()));
+      }
+   }
+   // Lower each edge one merged code point range at a time
+   for (auto& edgeItr : codePointRangesByEdge) {
+      std::vector<EdgePair>& codePointRanges = edgeItr.second;
+      std::sort(codePointRanges.begin(), codePointRanges.end());
+      MapUtf8TrieKeyToNode trie;
+      std::vector<Utf8Sequence> sequences;
+      EdgePair mergedRange = codePointRanges.front();
+      for (size_t i = 1; i <= codePointRanges.size(); i++) {
+         if (i < codePointRanges.size() &&
+             codePointRanges[i].first <= mergedRange.second + 1) {
+            mergedRange.second = std::max(mergedRange.second, codePointRanges[i].second);
+            continue;
+         }
+         getUtf8Sequences(sequences, mergedRange.first, mergedRange.second);
+         if (i < codePointRanges.size()) {
+            mergedRange = codePointRanges[i];
+         }
+      }
+      for (const auto& sequence : sequences) {
+         addUtf8Sequence(byteFsm, trie, sequence, edgeItr.first.first,
+                         edgeItr.first.second, nextNode);
+      }
+   }
+   return byteFsm;
+}
+
+/*******************************************************************************
+ * Add UTF-8 Byte Transition
+ * A helper method to add a transition labeled with a byte range.
+ * @param byteFsm       a reference to the byte-level FiniteStateMachine
+ * @param source        the source node of the transition
+ * @param byteRange     the inclusive range of bytes to add
+ * @param destination   the destination node of the transition
+ */
+void addUtf8ByteTransition(FiniteStateMachine& byteFsm, int source,
+                           const Utf8ByteRange& byteRange, int destination) {
+   Transition theTransition;
+   theTransition.source = source;
+   theTransition.transitionChar = byteRange.first;
+   theTransition.lastTransitionChar = byteRange.last;
+   theTransition.destination = destination;
+   byteFsm.transitions.push_back(theTransition);
+}
+
+/*******************************************************************************
+ * Add UTF-8 Sequence
+ * A helper method to add the chain of byte range transitions for one UTF-8
+ * sequence between a source and destination node. Chains of the same edge
+ * share nodes for identical leading byte ranges through the trie.
+ * @param byteFsm       a reference to the byte-level FiniteStateMachine
+ * @param trie          a reference to the map of shared chain nodes
+ * @param sequence      the byte range sequence to add
+ * @param source        the source node of the edge
+ * @param destination   the destination node of the edge
+ * @param nextNode      a reference to the next free node id
+ */
+void addUtf8Sequence(FiniteStateMachine& byteFsm, MapUtf8TrieKeyToNode& trie,
+                     const Utf8Sequence& sequence, int source, int destination,
+                     int& nextNode) {
+   int currentNode = source;
+   for (size_t i = 0; i < sequence.size(); i++) {
+      Utf8TrieKey key(currentNode, EdgePair(sequence[i].first, sequence[i].last));
+      if (trie.count(key) > 0) {
+         currentNode = trie.at(key);
+         continue;
+      }
+      int nextChainNode = destination;
+      if (i + 1 < sequence.size()) {
+         nextChainNode = nextNode++;
+         byteFsm.nodes.insert(nextChainNode);
+      }
+      addUtf8ByteTransition(byteFsm, currentNode, sequence[i], nextChainNode);
+      trie[key] = nextChainNode;
+      currentNode = nextChainNode;
+   }
+}
+
+/*******************************************************************************
+ * Decode UTF-8
+ * Reads the code point encoded at a position of a UTF-8 string and advances
+ * the position past it. Overlong encodings, surrogates, and truncated or
+ * malformed sequences are rejected.
+ * @param utf8Str       a reference to a UTF-8 string
+ * @param position      a reference to the position of the next byte
+ * @return              the decoded code point, or -1 if the bytes at the
+ *                      position are not valid UTF-8
+ */
+int decodeUtf8(const std::string& utf8Str, size_t& position) {
+   int leadByte = static_cast<unsigned char>(utf8Str[position]);
+   int length = 0;
+   int codePoint = 0;
+   if (leadByte <= 0x7F) {
+      position++;
+      return leadByte;
+   } else if (leadByte >= 0xC2 && leadByte <= 0xDF) {
+      length = 2;
+      codePoint = leadByte & 0x1F;
+   } else if (leadByte >= 0xE0 && leadByte <= 0xEF) {
+      length = 3;
+      codePoint = leadByte & 0x0F;
+   } else if (leadByte >= 0xF0 && leadByte <= 0xF4) {
+      length = 4;
+      codePoint = leadByte & 0x07;
+   } else {
+      return -1;
+   }
+   if (position + length > utf8Str.length()) {
+      return -1;
+   }
+   for (int i = 1; i < length; i++) {
+      int continuationByte = static_cast<unsigned char>(utf8Str[position + i]);
+      if ((continuationByte & 0xC0) != 0x80) {
+         return -1;
+      }
+      codePoint = (codePoint << 6) | (continuationByte & 0x3F);
+   }
+   // Reject overlong encodings and values without a valid encoding
+   unsigned char bytes[4];
+   if (encodeUtf8(codePoint, bytes) != length) {
+      return -1;
+   }
+   position += length;
+   return codePoint;
+}
+
+/*******************************************************************************
+ * Encode UTF-8
+ * Writes the UTF-8 encoding of a code point into a buffer of at least four
+ * bytes.
+ * @param codePoint     the code point to encode
+ * @param bytes         a pointer to the output buffer
+ * @return              the number of bytes written, or 0 if the code point
+ *                      has no UTF-8 encoding
+ */
+int encodeUtf8(int codePoint, unsigned char* bytes) {
+   if (codePoint < 0 || codePoint > MAX_CODE_POINT ||
+       (codePoint >= 0xD800 && codePoint <= 0xDFFF)) {
+      return 0;
+   }
+   if (codePoint <= 0x7F) {
+      bytes[0] = static_cast<unsigned char>(codePoint);
+      return 1;
+   }
+   if (codePoint <= 0x7FF) {
+      bytes[0] = static_cast<unsigned char>(0xC0 | (codePoint >> 6));
+      bytes[1] = static_cast<unsigned char>(0x80 | (codePoint & 0x3F));
+      return 2;
+   }
+   if (codePoint <= 0xFFFF) {
+      bytes[0] = static_cast<unsigned char>(0xE0 | (codePoint >> 12));
+      bytes[1] = static_cast<unsigned char>(0x80 | ((codePoint >> 6) & 0x3F));
+      bytes[2] = static_cast<unsigned char>(0x80 | (codePoint & 0x3F));
+      return 3;
+   }
+   bytes[0] = static_cast<unsigned char>(0xF0 | (codePoint >> 18));
+   bytes[1] = static_cast<unsigned char>(0x80 | ((codePoint >> 12) & 0x3F));
+   bytes[2] = static_cast<unsigned char>(0x80 | ((codePoint >> 6) & 0x3F));
+   bytes[3] = static_cast<unsigned char>(0x80 | (codePoint & 0x3F));
+   return 4;
+}
+
+/*******************************************************************************
+ * Get Next Free Node
+ * A helper method to find a node id larger than every node in the machine.
+ * @param fsm           a reference to a FiniteStateMachine
+ * @return              an unused node id
+ */
+int getNextFreeNode(const FiniteStateMachine& fsm) {
+   int largestNode = fsm.startNode;
+   for (int node : fsm.nodes) {
+      largestNode = std::max(largestNode, node);
+   }
+   for (const auto& transition : fsm.transitions) {
+      largestNode = std::max(largestNode, std::max(transition.source, transition.destination));
+   }
+   return largestNode + 1;
+}
+
+/*******************************************************************************
+ * Get UTF-8 Sequences
+ * Appends the byte range sequences matching exactly the UTF-8 encodings of an
+ * inclusive code point range. The range is split until both ends encode to
+ * the same length and differ only in whole trailing continuation bytes, at
+ * which point each byte position is a single contiguous range.
+ * @param sequences     a reference to the list of sequences to append to
+ * @param firstCodePoint
+ *                      the first code point in the range
+ * @param lastCodePoint the last code point in the range
+ */
+void getUtf8Sequences(std::vector<Utf8Sequence>& sequences,
+                      int firstCodePoint, int lastCodePoint) {
+   firstCodePoint = std::max(firstCodePoint, 0);
+   lastCodePoint = std::min(lastCodePoint, MAX_CODE_POINT);
+   if (firstCodePoint > lastCodePoint) {
+      return;
+   }
+   // Remove the surrogate code points
+   if (firstCodePoint <= 0xDFFF && lastCodePoint >= 0xD800) {
+      getUtf8Sequences(sequences, firstCodePoint, 0xD7FF);
+      getUtf8Sequences(sequences, 0xE000, lastCodePoint);
+      return;
+   }
+   // Split at the boundaries between encoded lengths
+   const int lengthBoundaries[] = { 0x7F, 0x7FF, 0xFFFF };
+   for (int boundary : lengthBoundaries) {
+      if (firstCodePoint <= boundary && boundary < lastCodePoint) {
+         getUtf8Sequences(sequences, firstCodePoint, boundary);
+         getUtf8Sequences(sequences, boundary + 1, lastCodePoint);
+         return;
+      }
+   }
+   // Split until the trailing continuation bytes cover full ranges
+   for (int i = 1; i < 4; i++) {
+      int mask = (1 << (6 * i)) - 1;
+      if ((firstCodePoint & ~mask) != (lastCodePoint & ~mask)) {
+         if ((firstCodePoint & mask) != 0) {
+            getUtf8Sequences(sequences, firstCodePoint, firstCodePoint | mask);
+            getUtf8Sequences(sequences, (firstCodePoint | mask) + 1, lastCodePoint);
+            return;
+         }
+         if ((lastCodePoint & mask) != mask) {
+            getUtf8Sequences(sequences, firstCodePoint, (lastCodePoint & ~mask) - 1);
+            getUtf8Sequences(sequences, lastCodePoint & ~mask, lastCodePoint);
+            return;
+         }
+      }
+   }
+   unsigned char firstBytes[4];
+   unsigned char lastBytes[4];
+   int length = encodeUtf8(firstCodePoint, firstBytes);
+   encodeUtf8(lastCodePoint, lastBytes);
+   Utf8Sequence sequence;
+   for (int i = 0; i < length; i++) {
+      Utf8ByteRange byteRange;
+      byteRange.first = firstBytes[i];
+      byteRange.last = lastBytes[i];
+      sequence.push_back(byteRange);
+   }
+   sequences.push_back(sequence);
+}
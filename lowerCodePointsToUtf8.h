@@ -0,0 +1,43 @@
+/*******************************************************************************
+ *  @author             Karl Jansen (kmjansen@uw.edu)
+ *  @version            1.2, 03/16/2015
+ *
+ *  Compilation:        N/A
+ *  Execution:          N/A
+ *  Dependencies:       FiniteStateMachine.cpp;
+ *
+ *  Description:
+ *  This file declares the functions used to lower a FiniteStateMachine over
+ *  Unicode code points into an equivalent FiniteStateMachine over UTF-8 bytes.
+ *
+ *  Functionality:
+ *  Provides the prototypes and data structures for the lowering step, along
+ *  with the UTF-8 encoding and decoding of single code points.
+ *
+*******************************************************************************/
+
+#ifndef LOWERCODEPOINTSTOUTF8_H
+#define LOWERCODEPOINTSTOUTF8_H
+
+#include "FiniteStateMachine.cpp"
+#include <string>
+#include <vector>
+
+// An inclusive range of byte values at one position of a UTF-8 sequence
+struct Utf8ByteRange {
+   int first;                                   // first byte in the range
+   int last;                                    // last byte in the range
+};
+
+// A sequence of byte ranges matching every encoding in a code point range
+typedef std::vector<Utf8ByteRange> Utf8Sequence;
+
+static const int MAX_CODE_POINT = 0x10FFFF;     // largest Unicode code point
+
+// Function Prototypes
+int decodeUtf8(const std::string&, size_t&);
+int encodeUtf8(int, unsigned char*);
+void getUtf8Sequences(std::vector<Utf8Sequence>&, int, int);
+FiniteStateMachine lowerCodePointsToUtf8(const FiniteStateMachine&);
+
+#endif
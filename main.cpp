@@ -2,10 +2,13 @@
  *  @author             Karl Jansen (kmjansen@uw.edu)
  *  @version            1.2, 03/16/2015
  *
- *  Compilation:        $> g++ main.cpp -o main -std=c++11
+ *  Compilation:        $> g++ main.cpp -o main -std=c++11 -pthread
  *  Execution:          $> main
- *  Dependencies:       CompiledDfa.cpp; CompiledNfaEpsilon.cpp;
- *                      convertNfaEpsilonToDfa.cpp;
+ *  Dependencies:       CompiledDfa.cpp; CompiledNfaEpsilon.cpp; CompiledLazyDfa.cpp;
+ *                      CompiledAutomaton.cpp;
+ *                      convertNfaEpsilonToDfa.cpp; lowerCodePointsToUtf8.cpp;
+ *                      convertRegexToNfaEpsilon.cpp; removeEpsilonTransitions.cpp;
+ *                      combineDfas.cpp; Prefilter.cpp; ScanningService.cpp;
  *
  *  Description:
  *  This program tests various classes for FiniteStateMachine objects.
@@ -25,10 +28,38 @@
 
 #include "CompiledDfa.cpp"
 #include "CompiledNfaEpsilon.cpp"
+#include "CompiledLazyDfa.cpp"
+#include "CompiledAutomaton.cpp"
 #include "convertNfaEpsilonToDfa.cpp"
+#include "lowerCodePointsToUtf8.cpp"
+#include "convertRegexToNfaEpsilon.cpp"
+#include "removeEpsilonTransitions.cpp"
+#include "combineDfas.cpp"
+#include "Prefilter.cpp"
+#include "ScanningService.cpp"
 #include <iostream>
 
 // Function Prototypes
+std::vector<std::pair<std::string, bool> > getTestCases(const std::list<std::string>&,
+                                                        const std::list<std::string>&);
+void runTestCases(CompiledNfaEpsilon&, CompiledDfa&,
+                  const std::list<std::string>&, const std::list<std::string>&);
+void testCompiledAutomaton(const std::string&, size_t, const std::list<std::string>&,
+                           const std::list<std::string>&);
+void testPrefilter(const std::string&, const std::list<std::string>&,
+                   const std::list<std::string>&);
+void testProductAutomata(FiniteStateMachine&, const std::list<std::string>&,
+                         const std::list<std::string>&);
+void testRangeTransitions();
+void testMemoryUsage(const std::string&, const std::list<std::string>&,
+                     const std::list<std::string>&);
+void testRegex(const std::string&, const std::list<std::string>&,
+               const std::list<std::string>&);
+void testRegexLimits();
+void testScanningService(const std::string&, const std::list<std::string>&,
+                         const std::list<std::string>&);
+void testSymbolLimits();
+void testUtf8Lowering();
 
 /*******************************************************************************
  * This is the main driver function of the clientransition. It manages important
@@ -132,6 +163,123 @@ int main() {
    negativeStrings.push_back("cb");
    
    // RUN TEST CASES
+   runTestCases(nfaEpsilon, dfa, positiveStrings, negativeStrings);
+
+   // Remove the epsilon transitions and run the same cases
+   FiniteStateMachine fsmNFA = removeEpsilonTransitions(fsmNFAe);
+   CompiledNfaEpsilon nfa(fsmNFA);
+   std::cout << ">> Epsilon-free NFA (" << fsmNFA.nodes.size() << " nodes, "
+             << fsmNFA.transitions.size() << " transitions)" << std::endl;
+   runTestCases(nfa, dfa, positiveStrings, negativeStrings);
+   testProductAutomata(fsmDFA, positiveStrings, negativeStrings);
+   testRangeTransitions();
+   testUtf8Lowering();
+   testSymbolLimits();
+   testRegex("(ab*|b*c|a*c*)", positiveStrings, negativeStrings);
+   positiveStrings.clear();
+   negativeStrings.clear();
+   positiveStrings.push_back("ab");
+   positiveStrings.push_back("ab-12");
+   positiveStrings.push_back("z0z0-7\xc3\xa9");
+   positiveStrings.push_back("\xce\xbb\xce\xbb.x");
+   negativeStrings.push_back("a");
+   negativeStrings.push_back("abcde");
+   negativeStrings.push_back("ab-");
+   negativeStrings.push_back("ab-x");
+   negativeStrings.push_back("ab\xc3\xa9\xc3\xa9");
+   negativeStrings.push_back("\xce\xbb\xce\xbb.\n");
+   testRegex("[a-z0-9]{2,4}(-\\d+)?\xc3\xa9?|\\x{3bb}+\\..", positiveStrings, negativeStrings);
+   positiveStrings.clear();
+   negativeStrings.clear();
+   testRegex("a(b|c", positiveStrings, negativeStrings);
+   testRegexLimits();
+   positiveStrings.push_back("GET /admin/x.php");
+   positiveStrings.push_back("GET /a/b/admin/.php");
+   positiveStrings.push_back("GET /admin/admin/.php");
+   negativeStrings.push_back("");
+   negativeStrings.push_back("GET /admin/x.ph");
+   negativeStrings.push_back("GET /x.php");
+   negativeStrings.push_back("POST /admin/x.php");
+   negativeStrings.push_back("GET /a/badmin/x.php");
+   negativeStrings.push_back("GET /admin.php");
+   testPrefilter("GET /(.*/)?admin/.*\\.php", positiveStrings, negativeStrings);
+   positiveStrings.clear();
+   negativeStrings.clear();
+   positiveStrings.push_back("abbb");
+   positiveStrings.push_back("bbaaaab");
+   negativeStrings.push_back("");
+   negativeStrings.push_back("bbb");
+   negativeStrings.push_back("abbbbbbb");
+   negativeStrings.push_back("abbbbbbbc");
+   testMemoryUsage("[ab]*a[ab]{3}", positiveStrings, negativeStrings);
+   positiveStrings.push_back("abbbbbbbb");
+   testMemoryUsage("[ab]*a[ab]{3}|[ab]*a[ab]{8}", positiveStrings, negativeStrings);
+   positiveStrings.clear();
+   negativeStrings.clear();
+   positiveStrings.push_back("user@example.com");
+   positiveStrings.push_back("a.b@c.org");
+   positiveStrings.push_back("x@y.io");
+   negativeStrings.push_back("");
+   negativeStrings.push_back("user@example");
+   negativeStrings.push_back("@example.com");
+   negativeStrings.push_back("user example.com");
+   negativeStrings.push_back("user@example.c");
+   testScanningService("[a-z.]+@[a-z]+\\.[a-z]{2,3}", positiveStrings, negativeStrings);
+   positiveStrings.clear();
+   negativeStrings.clear();
+   positiveStrings.push_back("abbbbbbbbbb");
+   positiveStrings.push_back("bbabababababa");
+   positiveStrings.push_back("aaaaaaaaaaaaa");
+   negativeStrings.push_back("");
+   negativeStrings.push_back("bbbbbbbbbbbb");
+   negativeStrings.push_back("abbbbbbbbb");
+   negativeStrings.push_back("abbbbbbbbbbb");
+   negativeStrings.push_back("abbbbbbbbbc");
+   testCompiledAutomaton("[ab]*a[ab]{10}", 100, positiveStrings, negativeStrings);
+
+   // END
+   return 0;
+}
+
+/*******************************************************************************
+ * Get Test Cases
+ * Lists the positive strings and then the negative strings, each paired with
+ * whether it should be recognized.
+ * @param positiveStrings
+ *                      the strings that should be recognized
+ * @param negativeStrings
+ *                      the strings that should not be recognized
+ * @return              every test string and its expected result
+ */
+std::vector<std::pair<std::string, bool> > getTestCases(
+   const std::list<std::string>& positiveStrings,
+   const std::list<std::string>& negativeStrings) {
+   std::vector<std::pair<std::string, bool> > testCases;
+   for (const std::string& testStr : positiveStrings) {
+      testCases.push_back(std::make_pair(testStr, true));
+   }
+   for (const std::string& testStr : negativeStrings) {
+      testCases.push_back(std::make_pair(testStr, false));
+   }
+   return testCases;
+}
+
+/*******************************************************************************
+ * Run Test Cases
+ * Evaluates every positive and negative input string on both the NFA-epsilon
+ * and the equivalent DFA, and prints the results. Then checks that the
+ * NFA-epsilon gives the same results with a scratch whose step count
+ * overflows partway through each input.
+ * @param nfaEpsilon    a reference to a compiled NFA-epsilon
+ * @param dfa           a reference to the equivalent compiled DFA
+ * @param positiveStrings
+ *                      the strings that should be recognized
+ * @param negativeStrings
+ *                      the strings that should not be recognized
+ */
+void runTestCases(CompiledNfaEpsilon& nfaEpsilon, CompiledDfa& dfa,
+                  const std::list<std::string>& positiveStrings,
+                  const std::list<std::string>& negativeStrings) {
    std::cout << ">> Positive Cases" << std::endl;
    for (std::string testStr : positiveStrings) {
       std::cout << testStr << std::endl;
@@ -146,8 +294,603 @@ int main() {
       std::cout << std::boolalpha << nfaEpsilon.isRecognized(testStr) << " & ";
       std::cout << std::boolalpha << dfa.isRecognized(testStr) << std::endl;
    }
+   NfaScratch scratch;
+   bool isSameAfterOverflow = true;
+   for (const auto& testCase : getTestCases(positiveStrings, negativeStrings)) {
+      nfaEpsilon.isRecognized(testCase.first, scratch);
+      scratch.step = INT_MAX - 1;
+      isSameAfterOverflow = isSameAfterOverflow &&
+                            nfaEpsilon.isRecognized(testCase.first, scratch) == testCase.second;
+   }
+   std::cout << "step count overflow" << std::endl;
+   std::cout << std::boolalpha << isSameAfterOverflow << std::endl;
    std::cout << std::endl;
+}
 
-   // END
-   return 0;
+/*******************************************************************************
+ * Test Compiled Automaton
+ * Compiles a regular expression to a NFA-e, and builds a compiled automaton
+ * for it with no budget, with a node budget, with a time budget, with a memory
+ * budget, and with a memory budget too small for any cache, and for a copy with
+ * a transition on a wide symbol with the node budget. These should choose the
+ * DFA, the lazy DFA three times, and the NFA-e twice. Runs the test cases on
+ * each, and checks that the lazy DFA stays within the node and memory budgets.
+ * @param pattern       the regular expression to compile
+ * @param maxStates     a node budget smaller than the DFA
+ * @param positiveStrings
+ *                      the strings that should be recognized
+ * @param negativeStrings
+ *                      the strings that should not be recognized
+ */
+void testCompiledAutomaton(const std::string& pattern, size_t maxStates,
+                           const std::list<std::string>& positiveStrings,
+                           const std::list<std::string>& negativeStrings) {
+   FiniteStateMachine fsmNFAe = convertRegexToNfaEpsilon(pattern);
+   FiniteStateMachine fsmWideNFAe = fsmNFAe;
+   Transition wideTransition;
+   wideTransition.source = fsmWideNFAe.startNode;
+   wideTransition.transitionChar = 0x3bb;
+   wideTransition.destination = -1;
+   fsmWideNFAe.nodes.insert(-1);
+   fsmWideNFAe.transitions.push_back(wideTransition);
+   ConversionBudget noBudget;
+   ConversionBudget stateBudget;
+   stateBudget.maxStates = maxStates;
+   ConversionBudget timeBudget;
+   timeBudget.maxSeconds = 1e-9;
+   CompiledAutomaton dfa(fsmNFAe, noBudget);
+   CompiledAutomaton lazyDfa(fsmNFAe, stateBudget);
+   CompiledAutomaton timedLazyDfa(fsmNFAe, timeBudget);
+   CompiledAutomaton nfaEpsilon(fsmWideNFAe, stateBudget);
+   ConversionResult conversion = convertNfaEpsilonToDfa(fsmNFAe, stateBudget);
+   ConversionBudget memoryBudget;
+   memoryBudget.maxMemoryBytes = 4 * lazyDfa.getMemoryUsage();
+   ConversionBudget tinyMemoryBudget;
+   tinyMemoryBudget.maxMemoryBytes = 1;
+   CompiledAutomaton memoryLazyDfa(fsmNFAe, memoryBudget);
+   CompiledAutomaton memoryNfaEpsilon(fsmNFAe, tinyMemoryBudget);
+
+   // RUN TEST CASES
+   std::cout << ">> Compiled Automaton " << pattern << " (" << maxStates << " nodes)" << std::endl;
+   std::cout << "partial DFA within budget" << std::endl;
+   std::cout << std::boolalpha
+             << (conversion.status == CONVERSION_STATE_LIMIT &&
+                 conversion.dfa.nodes.size() == maxStates) << std::endl;
+   std::cout << "kinds chosen" << std::endl;
+   std::cout << std::boolalpha
+             << (dfa.getKind() == COMPILED_DFA && lazyDfa.getKind() == COMPILED_LAZY_DFA &&
+                 timedLazyDfa.getKind() == COMPILED_LAZY_DFA &&
+                 timedLazyDfa.getConversionStatus() == CONVERSION_TIME_LIMIT &&
+                 nfaEpsilon.getKind() == COMPILED_NFA_EPSILON &&
+                 nfaEpsilon.getConversionStatus() == CONVERSION_STATE_LIMIT &&
+                 memoryLazyDfa.getKind() == COMPILED_LAZY_DFA &&
+                 memoryLazyDfa.getConversionStatus() == CONVERSION_MEMORY_LIMIT &&
+                 memoryNfaEpsilon.getKind() == COMPILED_NFA_EPSILON) << std::endl;
+   for (const auto& testCase : getTestCases(positiveStrings, negativeStrings)) {
+      const std::string& testStr = testCase.first;
+      bool isPositive = testCase.second;
+      std::cout << testStr << std::endl;
+      std::cout << std::boolalpha
+                << (dfa.isRecognized(testStr) == isPositive &&
+                    lazyDfa.isRecognized(testStr) == isPositive &&
+                    timedLazyDfa.isRecognized(testStr) == isPositive &&
+                    memoryLazyDfa.isRecognized(testStr) == isPositive &&
+                    memoryNfaEpsilon.isRecognized(testStr) == isPositive &&
+                    nfaEpsilon.isRecognized(testStr) == isPositive) << " : ";
+      std::cout << std::boolalpha << dfa.isRecognized(testStr) << " & "
+                << lazyDfa.isRecognized(testStr) << " & " << nfaEpsilon.isRecognized(testStr)
+                << std::endl;
+   }
+   std::cout << "wide symbol" << std::endl;
+   std::cout << std::boolalpha
+             << (!nfaEpsilon.isRecognized(std::vector<int>(1, 0x3bb)) &&
+                 !lazyDfa.isRecognized(std::vector<int>(1, 0x3bb))) << std::endl;
+   std::cout << "lazy DFA within memory budget" << std::endl;
+   std::cout << std::boolalpha
+             << (memoryLazyDfa.getMemoryUsage() <= memoryBudget.maxMemoryBytes) << std::endl;
+   std::cout << std::endl;
+}
+
+/*******************************************************************************
+ * Test Memory Usage
+ * Compiles a regular expression to a NFA-e and a DFA, prints the bytes used by
+ * both compiled automata, and runs the test cases. DFAs with more than 256
+ * states are stored with wider state IDs.
+ * @param pattern       the regular expression to compile
+ * @param positiveStrings
+ *                      the strings that should be recognized
+ * @param negativeStrings
+ *                      the strings that should not be recognized
+ */
+void testMemoryUsage(const std::string& pattern,
+                     const std::list<std::string>& positiveStrings,
+                     const std::list<std::string>& negativeStrings) {
+   FiniteStateMachine fsmNFAe = convertRegexToNfaEpsilon(pattern);
+   FiniteStateMachine fsmDFA = convertNfaEpsilonToDfa(fsmNFAe);
+   CompiledNfaEpsilon nfaEpsilon(fsmNFAe);
+   CompiledDfa dfa(fsmDFA);
+   std::cout << ">> Memory " << pattern << " (DFA " << fsmDFA.nodes.size() << " nodes, "
+             << dfa.getMemoryUsage() << " bytes; NFA-e " << fsmNFAe.nodes.size() << " nodes, "
+             << nfaEpsilon.getMemoryUsage() << " bytes)" << std::endl;
+   runTestCases(nfaEpsilon, dfa, positiveStrings, negativeStrings);
+}
+
+/*******************************************************************************
+ * Test Prefilter
+ * Compiles a regular expression to a NFA-e and a DFA, prints the prefilters
+ * extracted from both, and checks that the DFA gives the same result with the
+ * NFA-e prefilter, with its own prefilter, and with no prefilter.
+ * @param pattern       the regular expression to compile
+ * @param positiveStrings
+ *                      the strings that should be recognized
+ * @param negativeStrings
+ *                      the strings that should not be recognized
+ */
+void testPrefilter(const std::string& pattern,
+                   const std::list<std::string>& positiveStrings,
+                   const std::list<std::string>& negativeStrings) {
+   FiniteStateMachine fsmNFAe = convertRegexToNfaEpsilon(pattern);
+   FiniteStateMachine fsmDFA = convertNfaEpsilonToDfa(fsmNFAe);
+   Prefilter nfaEpsilonPrefilter(fsmNFAe);
+   Prefilter dfaPrefilter(fsmDFA);
+   CompiledDfa dfa(fsmDFA);
+   CompiledDfa prefilteredDfa(fsmDFA);
+   CompiledDfa unfilteredDfa(fsmDFA);
+   prefilteredDfa.setPrefilter(nfaEpsilonPrefilter);
+   unfilteredDfa.setPrefilterEnabled(false);
+
+   // RUN TEST CASES
+   std::cout << ">> Prefilter " << pattern << std::endl;
+   const Prefilter* const prefilters[] = { &nfaEpsilonPrefilter, &dfaPrefilter };
+   const char* const names[] = { "NFA-e", "DFA" };
+   for (int i = 0; i < 2; i++) {
+      std::cout << names[i] << " prefix \"" << prefilters[i]->getRequiredPrefix() << "\", literals";
+      for (const auto& literal : prefilters[i]->getRequiredLiterals()) {
+         std::cout << " \"" << literal << "\"";
+      }
+      std::cout << ", suffix \"" << prefilters[i]->getRequiredSuffix() << "\", at least "
+                << prefilters[i]->getMinimumLength() << " bytes" << std::endl;
+   }
+   for (const auto& testCase : getTestCases(positiveStrings, negativeStrings)) {
+      const std::string& testStr = testCase.first;
+      bool isPositive = testCase.second;
+      std::cout << testStr << std::endl;
+      std::cout << std::boolalpha
+                << (prefilteredDfa.isRecognized(testStr) == isPositive &&
+                    dfa.isRecognized(testStr) == isPositive &&
+                    unfilteredDfa.isRecognized(testStr) == isPositive) << " : ";
+      std::cout << std::boolalpha << nfaEpsilonPrefilter.mayMatch(testStr) << " & "
+                << dfaPrefilter.mayMatch(testStr) << std::endl;
+   }
+   std::cout << std::endl;
+}
+
+/*******************************************************************************
+ * Test Product Automata
+ * Combines a DFA with the DFA for a*b* by intersection, union, and difference,
+ * complements it, and minimizes the union. Each input is checked against the
+ * results of the separate DFAs.
+ * @param fsmDFA        a reference to a DFA FiniteStateMachine
+ * @param positiveStrings
+ *                      the strings recognized by the DFA
+ * @param negativeStrings
+ *                      the strings not recognized by the DFA
+ */
+void testProductAutomata(FiniteStateMachine& fsmDFA,
+                         const std::list<std::string>& positiveStrings,
+                         const std::list<std::string>& negativeStrings) {
+   FiniteStateMachine fsmOtherDFA = convertNfaEpsilonToDfa(convertRegexToNfaEpsilon("a*b*"));
+   FiniteStateMachine fsmUnion = unionOfDfas(fsmDFA, fsmOtherDFA);
+   FiniteStateMachine fsmMinimalUnion = minimizeDfa(fsmUnion);
+   CompiledDfa dfa(fsmDFA);
+   CompiledDfa otherDfa(fsmOtherDFA);
+   FiniteStateMachine fsmIntersection = intersectionOfDfas(fsmDFA, fsmOtherDFA);
+   FiniteStateMachine fsmDifference = differenceOfDfas(fsmDFA, fsmOtherDFA);
+   FiniteStateMachine fsmComplement = complementDfa(fsmDFA);
+   CompiledDfa intersectionDfa(fsmIntersection);
+   CompiledDfa unionDfa(fsmUnion);
+   CompiledDfa minimalUnionDfa(fsmMinimalUnion);
+   CompiledDfa differenceDfa(fsmDifference);
+   CompiledDfa complementOfDfa(fsmComplement);
+
+   // RUN TEST CASES
+   std::cout << ">> Product Cases (union " << fsmUnion.nodes.size() << " nodes, minimized "
+             << fsmMinimalUnion.nodes.size() << " nodes)" << std::endl;
+   for (const auto& testCase : getTestCases(positiveStrings, negativeStrings)) {
+      const std::string& testStr = testCase.first;
+      bool isInDfa = dfa.isRecognized(testStr);
+      bool isInOtherDfa = otherDfa.isRecognized(testStr);
+      std::cout << testStr << std::endl;
+      std::cout << std::boolalpha
+                << (intersectionDfa.isRecognized(testStr) == (isInDfa && isInOtherDfa) &&
+                    unionDfa.isRecognized(testStr) == (isInDfa || isInOtherDfa) &&
+                    minimalUnionDfa.isRecognized(testStr) == (isInDfa || isInOtherDfa) &&
+                    differenceDfa.isRecognized(testStr) == (isInDfa && !isInOtherDfa) &&
+                    complementOfDfa.isRecognized(testStr) == !isInDfa) << " : ";
+      std::cout << std::boolalpha << isInDfa << " & " << isInOtherDfa << std::endl;
+   }
+   std::cout << std::endl;
+}
+
+/*******************************************************************************
+ * Test Range Transitions
+ * Builds [a-z0-9]+(-[a-z0-9]+)* as a NFA-e with range labeled transitions,
+ * converts it to a DFA, and runs test cases that include a NUL byte.
+ */
+void testRangeTransitions() {
+   FiniteStateMachine fsmNFAe;
+   for (int node = 0; node <= 3; node++) {
+      fsmNFAe.nodes.insert(node);
+   }
+   fsmNFAe.startNode = 0;
+   fsmNFAe.goalNodes.insert(1);
+   const int sources[] = { 0, 1, 2, 3 };
+   const int destinations[] = { 1, 1, 3, 3 };
+   for (int i = 0; i < 4; i++) {
+      fsmNFAe.transitions.push_back(Transition(sources[i], 'a', destinations[i], 'z'));
+      fsmNFAe.transitions.push_back(Transition(sources[i], '0', destinations[i], '9'));
+   }
+   fsmNFAe.transitions.push_back({ 1, '-', 2 });
+   fsmNFAe.transitions.push_back({ 3, FiniteStateMachine::EPSILON, 1 });
+   CompiledNfaEpsilon nfaEpsilon(fsmNFAe);
+   FiniteStateMachine fsmDFA = convertNfaEpsilonToDfa(fsmNFAe);
+   CompiledDfa dfa(fsmDFA);
+
+   // CREATE TEST CASES
+   std::list<std::string> positiveStrings;
+   std::list<std::string> negativeStrings;
+   positiveStrings.push_back("a");
+   positiveStrings.push_back("z9");
+   positiveStrings.push_back("utf-8");
+   positiveStrings.push_back("x-0-y");
+   negativeStrings.push_back("");
+   negativeStrings.push_back("-");
+   negativeStrings.push_back("a-");
+   negativeStrings.push_back("a--b");
+   negativeStrings.push_back("A");
+   negativeStrings.push_back(std::string("a\0b", 3));
+
+   // RUN TEST CASES
+   std::cout << ">> Range Cases (" << fsmDFA.transitions.size() << " DFA transitions)" << std::endl;
+   runTestCases(nfaEpsilon, dfa, positiveStrings, negativeStrings);
+}
+
+/*******************************************************************************
+ * Test Regex
+ * Compiles a regular expression to a NFA-e, converts it to a DFA, and runs the
+ * test cases. An invalid pattern prints its error instead.
+ * @param pattern       the regular expression to compile
+ * @param positiveStrings
+ *                      the strings that should be recognized
+ * @param negativeStrings
+ *                      the strings that should not be recognized
+ */
+void testRegex(const std::string& pattern,
+               const std::list<std::string>& positiveStrings,
+               const std::list<std::string>& negativeStrings) {
+   std::cout << ">> Regex " << pattern << std::endl;
+   FiniteStateMachine fsmNFAe;
+   try {
+      fsmNFAe = convertRegexToNfaEpsilon(pattern);
+   } catch (const std::invalid_argument& error) {
+      std::cout << error.what() << std::endl << std::endl;
+      return;
+   }
+   CompiledNfaEpsilon nfaEpsilon(fsmNFAe);
+   FiniteStateMachine fsmDFA = convertNfaEpsilonToDfa(fsmNFAe);
+   CompiledDfa dfa(fsmDFA);
+   runTestCases(nfaEpsilon, dfa, positiveStrings, negativeStrings);
+}
+
+/*******************************************************************************
+ * Test Regex Limits
+ * Checks that patterns too deeply nested to parse or build, or that expand to
+ * too many nodes, are rejected with std::invalid_argument instead of
+ * overflowing the stack or running out of memory.
+ */
+void testRegexLimits() {
+   std::vector<std::string> patterns;
+   patterns.push_back(std::string(200000, '(') + "a" + std::string(200000, ')'));
+   patterns.push_back("a" + std::string(200000, '*'));
+   patterns.push_back("((a{1000}){1000}){1000}");
+   std::cout << ">> Regex Limits" << std::endl;
+   for (const std::string& pattern : patterns) {
+      bool isRejected = false;
+      try {
+         convertRegexToNfaEpsilon(pattern);
+      } catch (const std::invalid_argument& error) {
+         std::cout << error.what() << std::endl;
+         isRejected = true;
+      }
+      std::cout << std::boolalpha << isRejected << std::endl;
+   }
+   std::cout << std::endl;
+}
+
+/*******************************************************************************
+ * Test Scanning Service
+ * Compiles a regular expression to a NFA-e and a DFA, and recognizes every
+ * test case with a scanning service for each, half through callbacks and half
+ * through futures. Also checks that a shut down service refuses new inputs,
+ * that a callback that throws is counted, and that shutdown is refused from a
+ * callback and safe from two threads at once.
+ * @param pattern       the regular expression to compile
+ * @param positiveStrings
+ *                      the strings that should be recognized
+ * @param negativeStrings
+ *                      the strings that should not be recognized
+ */
+void testScanningService(const std::string& pattern,
+                         const std::list<std::string>& positiveStrings,
+                         const std::list<std::string>& negativeStrings) {
+   FiniteStateMachine fsmNFAe = convertRegexToNfaEpsilon(pattern);
+   CompiledNfaEpsilon nfaEpsilon(fsmNFAe);
+   CompiledDfa dfa(convertNfaEpsilonToDfa(fsmNFAe));
+   std::vector<std::string> testStrings(positiveStrings.cbegin(), positiveStrings.cend());
+   testStrings.insert(testStrings.end(), negativeStrings.cbegin(), negativeStrings.cend());
+
+   // RUN TEST CASES
+   std::cout << ">> Scanning Service " << pattern << std::endl;
+   std::vector<int> nfaEpsilonResults(testStrings.size(), -1);
+   std::vector<int> dfaResults(testStrings.size(), -1);
+   std::vector<std::future<bool> > nfaEpsilonFutures;
+   std::vector<std::future<bool> > dfaFutures;
+   {
+      // small queues, so submitting has to wait for the workers
+      ScanningService nfaEpsilonService(nfaEpsilon, 2, 2, 2);
+      ScanningService dfaService(dfa, 2, 2, 2);
+      for (size_t i = 0; i < testStrings.size(); i++) {
+         if (i % 2 == 0) {
+            nfaEpsilonService.submit(testStrings[i], [&nfaEpsilonResults, i](bool isRecognized) {
+               nfaEpsilonResults[i] = isRecognized;
+            });
+            dfaService.submit(testStrings[i], [&dfaResults, i](bool isRecognized) {
+               dfaResults[i] = isRecognized;
+            });
+         } else {
+            nfaEpsilonFutures.push_back(nfaEpsilonService.submit(testStrings[i]));
+            dfaFutures.push_back(dfaService.submit(testStrings[i]));
+         }
+      }
+      dfaService.shutdown();
+      std::future<bool> refusedFuture = dfaService.submit(testStrings[0]);
+      bool isFutureRefused = false;
+      try {
+         refusedFuture.get();
+      } catch (const std::runtime_error&) {
+         isFutureRefused = true;
+      }
+      std::cout << "refused after shutdown" << std::endl;
+      std::cout << std::boolalpha
+                << (!dfaService.submit(testStrings[0], [](bool) {}) && isFutureRefused &&
+                    dfaService.getCompletedCount() == testStrings.size()) << std::endl;
+   }
+   {
+      // a callback that throws is counted, and one that shuts the service
+      // down is refused, while two other threads shut it down at once
+      bool isShutdownRefused = false;
+      ScanningService callbackService(dfa, 1, 2, 2);
+      callbackService.submit(testStrings[0], [](bool) {
+         throw std::runtime_error("callback failed");
+      });
+      callbackService.submit(testStrings[0], [&callbackService, &isShutdownRefused](bool) {
+         try {
+            callbackService.shutdown();
+         } catch (const std::logic_error&) {
+            isShutdownRefused = true;
+         }
+      });
+      std::thread shutdownThread(&ScanningService::shutdown, &callbackService);
+      callbackService.shutdown();
+      shutdownThread.join();
+      std::cout << "failed callbacks counted" << std::endl;
+      std::cout << std::boolalpha
+                << (callbackService.getFailedCallbackCount() == 1 && isShutdownRefused &&
+                    callbackService.getCompletedCount() == 2) << std::endl;
+   }
+   for (size_t i = 1; i < testStrings.size(); i += 2) {
+      nfaEpsilonResults[i] = nfaEpsilonFutures[i / 2].get();
+      dfaResults[i] = dfaFutures[i / 2].get();
+   }
+   for (size_t i = 0; i < testStrings.size(); i++) {
+      int expected = i < positiveStrings.size();
+      std::cout << testStrings[i] << std::endl;
+      std::cout << std::boolalpha
+                << (nfaEpsilonResults[i] == expected && dfaResults[i] == expected) << " : "
+                << static_cast<bool>(nfaEpsilonResults[i]) << " & "
+                << static_cast<bool>(dfaResults[i]) << std::endl;
+   }
+   std::cout << std::endl;
+}
+
+/*******************************************************************************
+ * Test Symbol Limits
+ * Builds a NFA-e with a range that ends at MAX_SYMBOL, runs wide symbol test
+ * cases through both engines and the complement over [0, MAX_SYMBOL], then
+ * checks that a symbol above MAX_SYMBOL, a reversed range, and an epsilon
+ * transition with a range are rejected.
+ */
+void testSymbolLimits() {
+   const int maxSymbol = FiniteStateMachine::MAX_SYMBOL;
+   FiniteStateMachine fsmNFAe;
+   fsmNFAe.nodes.insert(0);
+   fsmNFAe.nodes.insert(1);
+   fsmNFAe.startNode = 0;
+   fsmNFAe.goalNodes.insert(1);
+   fsmNFAe.transitions.push_back(Transition(0, maxSymbol - 1, 1, maxSymbol));
+   fsmNFAe.transitions.push_back(Transition(0, 'a', 1, 'z'));
+   fsmNFAe.transitions.push_back(Transition(1, maxSymbol, 1));
+   CompiledNfaEpsilon nfaEpsilon(fsmNFAe);
+   FiniteStateMachine fsmDFA = convertNfaEpsilonToDfa(fsmNFAe);
+   CompiledDfa dfa(fsmDFA);
+   CompiledDfa complementOfDfa(complementDfa(fsmDFA, maxSymbol));
+
+   // CREATE TEST CASES
+   std::list<std::vector<int> > positiveSymbols;
+   std::list<std::vector<int> > negativeSymbols;
+   positiveSymbols.push_back({ maxSymbol });
+   positiveSymbols.push_back({ maxSymbol - 1, maxSymbol });
+   positiveSymbols.push_back({ 'a', maxSymbol, maxSymbol });
+   negativeSymbols.push_back({});
+   negativeSymbols.push_back({ maxSymbol - 2 });
+   negativeSymbols.push_back({ maxSymbol, maxSymbol - 1 });
+   negativeSymbols.push_back({ 'a', 'a' });
+
+   // RUN TEST CASES
+   std::cout << ">> Symbol Limit Cases" << std::endl;
+   for (int expected = 1; expected >= 0; expected--) {
+      for (const auto& symbols : (expected ? positiveSymbols : negativeSymbols)) {
+         bool nfaResult = nfaEpsilon.isRecognized(symbols);
+         bool dfaResult = dfa.isRecognized(symbols);
+         bool complementResult = complementOfDfa.isRecognized(symbols);
+         std::cout << std::boolalpha
+                   << (nfaResult == (expected == 1) && dfaResult == nfaResult &&
+                       complementResult == !nfaResult) << " : ";
+         std::cout << std::boolalpha << nfaResult << " & " << dfaResult
+                   << " & " << complementResult << std::endl;
+      }
+   }
+
+   // A range ending at INT_MAX has no room for the boundary past its end
+   fsmNFAe.transitions.push_back(Transition(1, maxSymbol, 0, INT_MAX));
+   int rejectedCount = 0;
+   try {
+      CompiledNfaEpsilon rejectedNfa(fsmNFAe);
+   } catch (const std::invalid_argument&) {
+      rejectedCount++;
+   }
+   try {
+      convertNfaEpsilonToDfa(fsmNFAe);
+   } catch (const std::invalid_argument&) {
+      rejectedCount++;
+   }
+   try {
+      complementDfa(fsmDFA, INT_MAX);
+   } catch (const std::invalid_argument&) {
+      rejectedCount++;
+   }
+   std::cout << "symbols above MAX_SYMBOL rejected" << std::endl;
+   std::cout << std::boolalpha << (rejectedCount == 3) << std::endl;
+
+   // Malformed labels are rejected by every pass that reads them
+   rejectedCount = 0;
+   const Transition malformedTransitions[] = {
+      Transition(0, 'z', 1, 'a'),
+      Transition(0, FiniteStateMachine::EPSILON, 1, 'a'),
+      Transition(0, FiniteStateMachine::EPSILON, 1, FiniteStateMachine::EPSILON)
+   };
+   for (const Transition& malformedTransition : malformedTransitions) {
+      fsmNFAe.transitions.back() = malformedTransition;
+      try {
+         CompiledNfaEpsilon rejectedNfa(fsmNFAe);
+      } catch (const std::invalid_argument&) {
+         rejectedCount++;
+      }
+      try {
+         removeEpsilonTransitions(fsmNFAe);
+      } catch (const std::invalid_argument&) {
+         rejectedCount++;
+      }
+   }
+   std::cout << "malformed transition labels rejected" << std::endl;
+   std::cout << std::boolalpha << (rejectedCount == 6) << std::endl;
+   std::cout << std::endl;
+}
+
+/*******************************************************************************
+ * Test UTF-8 Lowering
+ * Builds ([U+03B1-U+03C9] | U+20AC)+ followed by a NUL byte over code points,
+ * lowers it to UTF-8 bytes, and checks that the byte-level automata agree with
+ * the code point automaton on each input. Also checks that a symbol stored
+ * through a signed char is rejected.
+ */
+void testUtf8Lowering() {
+   FiniteStateMachine fsmCodePoints;
+   fsmCodePoints.nodes.insert(0);
+   fsmCodePoints.nodes.insert(1);
+   fsmCodePoints.nodes.insert(2);
+   fsmCodePoints.startNode = 0;
+   fsmCodePoints.goalNodes.insert(2);
+   Transition transition;
+   transition.transitionChar = 0x03B1;
+   transition.lastTransitionChar = 0x03C9;
+   transition.source = 0;
+   transition.destination = 1;
+   fsmCodePoints.transitions.push_back(transition);
+   transition.source = 1;
+   fsmCodePoints.transitions.push_back(transition);
+   transition.transitionChar = 0x20AC;
+   transition.lastTransitionChar = Transition::SINGLE_CHAR;
+   transition.source = 0;
+   fsmCodePoints.transitions.push_back(transition);
+   transition.source = 1;
+   fsmCodePoints.transitions.push_back(transition);
+   transition.transitionChar = 0;
+   transition.destination = 2;
+   fsmCodePoints.transitions.push_back(transition);
+   CompiledNfaEpsilon codePointNfa(fsmCodePoints);
+
+   // Lower to UTF-8 bytes and compile both byte-level engines
+   FiniteStateMachine fsmBytes = lowerCodePointsToUtf8(fsmCodePoints);
+   CompiledNfaEpsilon byteNfa(fsmBytes);
+   FiniteStateMachine fsmBytesDFA = convertNfaEpsilonToDfa(fsmBytes);
+   CompiledDfa byteDfa(fsmBytesDFA);
+
+   // CREATE TEST CASES
+   std::list<std::vector<int> > positiveCodePoints;
+   std::list<std::vector<int> > negativeCodePoints;
+   positiveCodePoints.push_back({ 0x03B1, 0 });
+   positiveCodePoints.push_back({ 0x03B1, 0x03B2, 0x03C9, 0 });
+   positiveCodePoints.push_back({ 0x20AC, 0x03BB, 0x20AC, 0 });
+   negativeCodePoints.push_back({ 0 });
+   negativeCodePoints.push_back({ 0x03B1 });
+   negativeCodePoints.push_back({ 0x03B0, 0 });
+   negativeCodePoints.push_back({ 0x03CA, 0 });
+   negativeCodePoints.push_back({ 0x20AB, 0 });
+   negativeCodePoints.push_back({ 0x03B1, 0, 0 });
+
+   // RUN TEST CASES
+   std::cout << ">> UTF-8 Cases" << std::endl;
+   for (int expected = 1; expected >= 0; expected--) {
+      for (const auto& codePoints : (expected ? positiveCodePoints : negativeCodePoints)) {
+         std::string utf8Str;
+         for (int codePoint : codePoints) {
+            unsigned char bytes[4];
+            int length = encodeUtf8(codePoint, bytes);
+            utf8Str.append(reinterpret_cast<char*>(bytes), length);
+         }
+         bool codePointResult = codePointNfa.isRecognized(codePoints);
+         bool nfaResult = byteNfa.isRecognized(utf8Str);
+         bool dfaResult = byteDfa.isRecognized(utf8Str);
+         std::cout << std::boolalpha
+                   << (codePointResult == (expected == 1) &&
+                       nfaResult == codePointResult &&
+                       dfaResult == codePointResult) << " : ";
+         std::cout << std::boolalpha << codePointResult << " & " << nfaResult
+                   << " & " << dfaResult << std::endl;
+      }
+   }
+
+   // A byte above 127 stored through a signed char is negative, and rejected
+   transition.transitionChar = '\xe9';
+   fsmCodePoints.transitions.push_back(transition);
+   int rejectedCount = 0;
+   try {
+      CompiledNfaEpsilon rejectedNfa(fsmCodePoints);
+   } catch (const std::invalid_argument&) {
+      rejectedCount++;
+   }
+   try {
+      convertNfaEpsilonToDfa(fsmCodePoints);
+   } catch (const std::invalid_argument&) {
+      rejectedCount++;
+   }
+   try {
+      CompiledDfa rejectedDfa(fsmCodePoints);
+   } catch (const std::invalid_argument&) {
+      rejectedCount++;
+   }
+   std::cout << "negative symbols rejected" << std::endl;
+   std::cout << std::boolalpha << (rejectedCount == 3) << std::endl;
+   std::cout << std::endl;
 }
@@ -0,0 +1,185 @@
+/*******************************************************************************
+ *  @author             Karl Jansen (kmjansen@uw.edu)
+ *  @version            1.2, 03/16/2015
+ *
+ *  Compilation:        N/A
+ *  Execution:          N/A
+ *  Dependencies:       removeEpsilonTransitions.h;
+ *
+ *  Description:
+ *  This program converts a NFA-epsilon FiniteStateMachine into an equivalent
+ *  NFA FiniteStateMachine with no epsilon transitions.
+ *
+ *  Functionality:
+ *  Every node reachable from the start node is given the non-epsilon
+ *  transitions of all the nodes in its epsilon closure, and becomes a goal node
+ *  if its epsilon closure contains a goal node. Only nodes reachable through
+ *  the new transitions are kept, and nodes from which no goal node can be
+ *  reached are pruned along with their transitions. The result can be
+ *  recognized by CompiledNfaEpsilon without computing any epsilon closures,
+ *  or converted to a DFA like any other NFA.
+ *
+ *  Assumptions:
+ *  The FiniteStateMachine passed into the function is a valid NFA-epsilon.
+ *  Node ids are preserved, and the start node is always kept.
+ *
+*******************************************************************************/
+
+#include "removeEpsilonTransitions.h"
+#include <set>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+// Definitions
+typedef std::unordered_map<int, std::vector<Transition> > MapNodeToOutgoingTransitions;
+typedef std::unordered_map<int, std::vector<int> > MapNodeToPredecessors;
+
+// Data for the epsilon elimination algorithm
+struct EpsilonEliminationData {
+   FiniteStateMachine nfa;
+   MapNodeToOutgoingTransitions epsilonTransitionsBySource;
+   MapNodeToOutgoingTransitions transitionsBySource;
+};
+
+// Function Prototypes
+void addClosureTransitions(EpsilonEliminationData&, int, const std::vector<int>&,
+                           std::vector<int>&);
+void getEpsilonClosureOfNode(const EpsilonEliminationData&, int, std::vector<int>&);
+void pruneDeadNodes(FiniteStateMachine&);
+
+/*******************************************************************************
+ * Remove Epsilon Transitions
+ * Takes an NFA-epsilon and converts it to an equivalent NFA with no epsilon
+ * transitions. This process takes O(n * t) time where n is the number of nodes
+ * and t is the number of transitions in the NFA-e.
+ * @param inputNfaEpsilon
+ *                      a reference to a NFA-epsilon FiniteStateMachine
+ * @return              an epsilon-free NFA FiniteStateMachine
+ */
+FiniteStateMachine removeEpsilonTransitions(const FiniteStateMachine& inputNfaEpsilon) {
+   inputNfaEpsilon.checkSymbols();
+   EpsilonEliminationData epsilonEliminationData;
+   for (const auto& transition : inputNfaEpsilon.transitions) {
+      if (transition.transitionChar == FiniteStateMachine::EPSILON) {
+         epsilonEliminationData.epsilonTransitionsBySource[transition.source].push_back(transition);
+      } else {
+         epsilonEliminationData.transitionsBySource[transition.source].push_back(transition);
+      }
+   }
+   FiniteStateMachine& nfa = epsilonEliminationData.nfa;
+   nfa.startNode = inputNfaEpsilon.startNode;
+   nfa.nodes.insert(nfa.startNode);
+   // Visit the nodes reachable through the new transitions
+   std::vector<int> pendingNodes(1, nfa.startNode);
+   while (!pendingNodes.empty()) {
+      int node = pendingNodes.back();
+      pendingNodes.pop_back();
+      std::vector<int> closure;
+      getEpsilonClosureOfNode(epsilonEliminationData, node, closure);
+      for (int closureNode : closure) {
+         if (inputNfaEpsilon.goalNodes.count(closureNode) > 0) {
+            nfa.goalNodes.insert(node);
+            break;
+         }
+      }
+      addClosureTransitions(epsilonEliminationData, node, closure, pendingNodes);
+   }
+   pruneDeadNodes(nfa);
+   return nfa;
+}
+
+/*******************************************************************************
+ * Add Closure Transitions
+ * A helper method to give a node the non-epsilon transitions of every node in
+ * its epsilon closure, skipping duplicates, and to queue the destinations that
+ * have not been visited yet.
+ * @param epsilonEliminationData
+ *                      a reference to the epsilon elimination data
+ * @param node          the node to add transitions to
+ * @param closure       a reference to the epsilon closure of the node
+ * @param pendingNodes  a reference to the nodes waiting to be visited
+ */
+void addClosureTransitions(EpsilonEliminationData& epsilonEliminationData, int node,
+                           const std::vector<int>& closure, std::vector<int>& pendingNodes) {
+   FiniteStateMachine& nfa = epsilonEliminationData.nfa;
+   std::set<std::tuple<int, int, int> > seenLabels;
+   for (int closureNode : closure) {
+      MapNodeToOutgoingTransitions::const_iterator transitionItr =
+         epsilonEliminationData.transitionsBySource.find(closureNode);
+      if (transitionItr == epsilonEliminationData.transitionsBySource.cend()) {
+         continue;
+      }
+      for (Transition transition : transitionItr->second) {
+         if (!seenLabels.insert(std::make_tuple(transition.transitionChar,
+                                                transition.getLastTransitionChar(),
+                                                transition.destination)).second) {
+            continue;
+         }
+         transition.source = node;
+         nfa.transitions.push_back(transition);
+         if (nfa.nodes.insert(transition.destination).second) {
+            pendingNodes.push_back(transition.destination);
+         }
+      }
+   }
+}
+
+/*******************************************************************************
+ * Get Epsilon Closure of Node
+ * A helper method to find every node reachable from a node through epsilon
+ * transitions alone, including the node itself.
+ * @param epsilonEliminationData
+ *                      a reference to the epsilon elimination data
+ * @param node          the node to start from
+ * @param closure       a reference to the vector of nodes to fill
+ */
+void getEpsilonClosureOfNode(const EpsilonEliminationData& epsilonEliminationData, int node,
+                             std::vector<int>& closure) {
+   std::unordered_set<int> visitedNodes;
+   visitedNodes.insert(node);
+   closure.push_back(node);
+   for (size_t i = 0; i < closure.size(); i++) {
+      MapNodeToOutgoingTransitions::const_iterator epsilonItr =
+         epsilonEliminationData.epsilonTransitionsBySource.find(closure[i]);
+      if (epsilonItr == epsilonEliminationData.epsilonTransitionsBySource.cend()) {
+         continue;
+      }
+      for (const auto& transition : epsilonItr->second) {
+         if (visitedNodes.insert(transition.destination).second) {
+            closure.push_back(transition.destination);
+         }
+      }
+   }
+}
+
+/*******************************************************************************
+ * Prune Dead Nodes
+ * A helper method to remove the nodes from which no goal node can be reached,
+ * along with every transition into or out of them. The start node is kept so
+ * the result is always a valid FiniteStateMachine.
+ * @param nfa           a reference to the epsilon-free NFA to prune
+ */
+void pruneDeadNodes(FiniteStateMachine& nfa) {
+   MapNodeToPredecessors predecessors;
+   for (const auto& transition : nfa.transitions) {
+      predecessors[transition.destination].push_back(transition.source);
+   }
+   std::unordered_set<int> liveNodes(nfa.goalNodes.cbegin(), nfa.goalNodes.cend());
+   std::vector<int> pendingNodes(nfa.goalNodes.cbegin(), nfa.goalNodes.cend());
+   while (!pendingNodes.empty()) {
+      int node = pendingNodes.back();
+      pendingNodes.pop_back();
+      for (int predecessor : predecessors[node]) {
+         if (liveNodes.insert(predecessor).second) {
+            pendingNodes.push_back(predecessor);
+         }
+      }
+   }
+   liveNodes.insert(nfa.startNode);
+   nfa.transitions.remove_if([&liveNodes](const Transition& transition) {
+      return liveNodes.count(transition.source) == 0 ||
+             liveNodes.count(transition.destination) == 0;
+   });
+   nfa.nodes = liveNodes;
+}
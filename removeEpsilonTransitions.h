@@ -0,0 +1,26 @@
+/*******************************************************************************
+ *  @author             Karl Jansen (kmjansen@uw.edu)
+ *  @version            1.2, 03/16/2015
+ *
+ *  Compilation:        N/A
+ *  Execution:          N/A
+ *  Dependencies:       FiniteStateMachine.cpp;
+ *
+ *  Description:
+ *  This file declares the function used to convert a NFA-epsilon
+ *  FiniteStateMachine into an equivalent NFA without epsilon transitions.
+ *
+ *  Functionality:
+ *  Provides the prototype for the epsilon elimination pass.
+ *
+*******************************************************************************/
+
+#ifndef REMOVEEPSILONTRANSITIONS_H
+#define REMOVEEPSILONTRANSITIONS_H
+
+#include "FiniteStateMachine.cpp"
+
+// Function Prototypes
+FiniteStateMachine removeEpsilonTransitions(const FiniteStateMachine&);
+
+#endif